@@ -0,0 +1,462 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <chrono>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "batchmode.h"
+#include "node.h"
+#include "nodepool.h"
+#include "redblack.h"
+#include "treeiterator.h"
+#include "snapshot.h"
+
+using namespace std;
+
+// the operations in an operation log
+static const int32_t LOG_INSERT = 0;
+static const int32_t LOG_REMOVE = 1;
+static const int32_t LOG_SEARCH = 2;
+static const int32_t LOG_MULTISET = 3; // 1 turns counting on, 0 off
+
+/**
+ * This function reads the next whole number from text, moving text past
+ * it. Returns false if there isn't one (or it doesn't fit in an int).
+ */
+static bool readNumber(const char* &text, int &number)
+{
+  while (*text == ' ' || *text == '\t' || *text == '\r')
+    {
+      text++;
+    }
+  if (*text == '\0')
+    {
+      return false;
+    }
+  char* end = NULL;
+  errno = 0;
+  long value = strtol(text, &end, 10);
+  if (end == text || errno != 0 || value < INT32_MIN || value > INT32_MAX)
+    {
+      return false;
+    }
+  text = end;
+  number = (int)value;
+  return true;
+}
+
+// skips spaces in text and returns whether that was the end of it
+static bool atLineEnd(const char* &text)
+{
+  while (*text == ' ' || *text == '\t' || *text == '\r')
+    {
+      text++;
+    }
+  return *text == '\0';
+}
+
+// reads the next word (up to a space) from text into word, moving text past it
+static void readWord(const char* &text, string &word)
+{
+  while (*text == ' ' || *text == '\t' || *text == '\r')
+    {
+      text++;
+    }
+  const char* start = text;
+  while (*text != '\0' && *text != ' ' && *text != '\t' && *text != '\r')
+    {
+      text++;
+    }
+  word.assign(start, text - start);
+}
+
+// appends one record to the operation log, if there is one
+static void record(ofstream &log, int32_t operation, int32_t value)
+{
+  if (log.is_open())
+    {
+      log.write((const char*)&operation, sizeof(operation));
+      log.write((const char*)&value, sizeof(value));
+    }
+}
+
+// prints one value of a range, for rangeVisit
+static void printValue(Node* node, void* data)
+{
+  bool* first = (bool*)data;
+  if (!*first)
+    {
+      cout << ' ';
+    }
+  cout << node->getValue();
+  *first = false;
+}
+
+/**
+ * This function runs the commands read from in (see batchmode.h) on a new
+ * tree. Returns the number of lines that had errors.
+ *
+ * @param recordFile | where to write an operation log, or NULL for none
+ */
+int runBatch(istream &in, const char* recordFile)
+{
+  Node* root = NULL;
+  NodePool pool;
+  bool counting = false; // multiset mode (see "multiset on")
+  ofstream log;
+  if (recordFile != NULL)
+    {
+      log.open(recordFile, ios::out | ios::binary | ios::trunc);
+      if (!log)
+	{
+	  cerr << "could not open " << recordFile << endl;
+	  return 1;
+	}
+      log.write("RBOP", 4);
+    }
+
+  int errors = 0;
+  int lineNumber = 0;
+  string line;
+  string command;
+  while (getline(in, line))
+    {
+      lineNumber++;
+      const char* text = line.c_str();
+      readWord(text, command);
+      if (command.empty() || command[0] == '#')
+	{
+	  continue;
+	}
+
+      // every operand is read (and the line checked for leftovers) before
+      // anything runs, so a line with an error changes nothing
+      bool bad = false; // a value was missing or wasn't a number
+      vector<int> values;
+      string word; // the file name or multiset setting
+      int value = 0;
+      if (command == "insert" || command == "remove")
+	{
+	  while (readNumber(text, value))
+	    {
+	      values.push_back(value);
+	    }
+	  bad = values.empty();
+	}
+      else if (command == "search")
+	{
+	  bad = !readNumber(text, value);
+	}
+#ifndef NO_ORDER_STATISTICS
+      // sizes are only kept for these two when order statistics are on
+      else if (command == "rank" || command == "select")
+	{
+	  bad = !readNumber(text, value);
+	}
+#endif
+      else if (command == "range")
+	{
+	  int high = 0;
+	  bad = !readNumber(text, value) || !readNumber(text, high);
+	  values.push_back(high);
+	}
+      else if (command == "save" || command == "load")
+	{
+	  readWord(text, word);
+	}
+#ifdef RBTREE_MULTISET
+      else if (command == "multiset")
+	{
+	  readWord(text, word);
+	}
+#endif
+      else if (command != "size" && command != "print" && command != "clear")
+	{
+	  cerr << "line " << lineNumber << ": unknown command " << command
+	       << endl;
+	  errors++;
+	  continue;
+	}
+      if (bad)
+	{
+	  cerr << "line " << lineNumber << ": " << command
+	       << " needs a number" << endl;
+	  errors++;
+	  continue;
+	}
+      if (!atLineEnd(text))
+	{
+	  cerr << "line " << lineNumber << ": unexpected \"" << text
+	       << "\" after " << command << endl;
+	  errors++;
+	  continue;
+	}
+
+      if (command == "insert" && counting)
+	{
+	  // the whole line goes in as one batch, repeats and all
+#ifdef RBTREE_MULTISET
+	  insertBatchCounted(root, &values[0], values.size(), pool);
+#endif
+	  for (size_t i = 0; i < values.size(); i++)
+	    {
+	      record(log, LOG_INSERT, values[i]);
+	    }
+	}
+      else if (command == "insert")
+	{
+	  for (size_t i = 0; i < values.size(); i++)
+	    {
+	      Node* newnode = pool.getNode(values[i]);
+	      if (!insert(root, root, newnode))
+		{
+		  pool.returnNode(newnode);
+		}
+	      record(log, LOG_INSERT, values[i]);
+	    }
+	}
+      else if (command == "remove")
+	{
+	  for (size_t i = 0; i < values.size(); i++)
+	    {
+#ifdef RBTREE_MULTISET
+	      if (counting)
+		{
+		  removeCounted(root, values[i], pool);
+		}
+	      else
+#endif
+	      if (search(root, values[i]) != NULL)
+		{
+		  remove(root, root, values[i], pool);
+		}
+	      record(log, LOG_REMOVE, values[i]);
+	    }
+	}
+      else if (command == "search")
+	{
+	  Node* found = search(root, value);
+	  if (counting) // how many copies there are
+	    {
+	      cout << (found != NULL ? found->getCount() : 0) << '\n';
+	    }
+	  else
+	    {
+	      cout << (found != NULL ? 1 : 0) << '\n';
+	    }
+	  record(log, LOG_SEARCH, value);
+	}
+      else if (command == "range")
+	{
+	  bool first = true;
+	  rangeVisit(root, value, values[0], printValue, &first);
+	  cout << '\n';
+	}
+#ifndef NO_ORDER_STATISTICS
+      else if (command == "rank")
+	{
+	  cout << rankOf(root, value) << '\n';
+	}
+      else if (command == "select") // 1 is the smallest, like the menu
+	{
+	  Node* found = selectKth(root, value - 1);
+	  if (found != NULL)
+	    {
+	      cout << found->getValue() << '\n';
+	    }
+	  else
+	    {
+	      cout << "none" << '\n';
+	    }
+	}
+#endif
+#ifdef RBTREE_MULTISET
+      else if (command == "multiset")
+	{
+	  if (word == "on" || word == "off")
+	    {
+	      counting = (word == "on");
+	      record(log, LOG_MULTISET, counting ? 1 : 0);
+	    }
+	  else
+	    {
+	      cerr << "line " << lineNumber << ": multiset needs on or off"
+		   << endl;
+	      errors++;
+	    }
+	}
+#endif
+      else if (command == "size")
+	{
+	  cout << pool.getNodesInUse() << '\n';
+	}
+      else if (command == "print")
+	{
+	  print(root, 0);
+	}
+      else if (command == "clear")
+	{
+	  pool.clear();
+	  root = NULL;
+	}
+      else if (word.empty()) // save or load without a file name
+	{
+	  cerr << "line " << lineNumber << ": " << command
+	       << " needs a file name" << endl;
+	  errors++;
+	}
+      else if (command == "save")
+	{
+	  if (!saveSnapshot(root, word.c_str()))
+	    {
+	      cerr << "line " << lineNumber << ": could not save " << word
+		   << endl;
+	      errors++;
+	    }
+	}
+      else
+	{
+	  // a file that can't be loaded leaves the tree as it was
+	  Node* loaded = NULL;
+	  NodePool loadedPool;
+	  if (!loadSnapshot(loaded, word.c_str(), loadedPool))
+	    {
+	      cerr << "line " << lineNumber << ": could not load " << word
+		   << endl;
+	      errors++;
+	    }
+	  else
+	    {
+	      pool.clear();
+	      pool.adopt(loadedPool);
+	      root = loaded;
+	    }
+	}
+    }
+  cout.flush();
+  return errors;
+}
+
+/**
+ * This function runs an operation log (see batchmode.h) against an empty
+ * tree and prints how many operations it ran and how fast. The log is
+ * memory-mapped, so reading it costs next to nothing. Returns 1 if
+ * the file can't be read or isn't an operation log, and 0 otherwise.
+ */
+int replayLog(const char* filename)
+{
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    {
+      cerr << "could not open " << filename << endl;
+      return 1;
+    }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < 4 || (info.st_size - 4) % 8 != 0)
+    {
+      close(fd);
+      cerr << filename << " is not an operation log" << endl;
+      return 1;
+    }
+  void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED || memcmp(data, "RBOP", 4) != 0)
+    {
+      if (data != MAP_FAILED)
+	{
+	  munmap(data, info.st_size);
+	}
+      cerr << filename << " is not an operation log" << endl;
+      return 1;
+    }
+  madvise(data, info.st_size, MADV_SEQUENTIAL);
+  const int32_t* records = (const int32_t*)((const char*)data + 4);
+  long count = (info.st_size - 4) / 8;
+
+  Node* root = NULL;
+  NodePool pool;
+#ifdef RBTREE_MULTISET
+  bool counting = false; // multiset mode, switched by LOG_MULTISET
+#endif
+  long found = 0; // searches that found their value
+  long bad = 0; // records with an unknown operation
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (long i = 0; i < count; i++)
+    {
+      int32_t operation = records[i * 2];
+      int32_t value = records[i * 2 + 1];
+#ifdef RBTREE_MULTISET
+      if (counting && operation == LOG_INSERT)
+	{
+	  insertCounted(root, value, pool);
+	}
+      else if (counting && operation == LOG_REMOVE)
+	{
+	  removeCounted(root, value, pool);
+	}
+      else if (operation == LOG_MULTISET && (value == 0 || value == 1))
+	{
+	  counting = (value == 1);
+	}
+      else
+#endif
+      if (operation == LOG_INSERT)
+	{
+	  Node* newnode = pool.getNode(value);
+	  if (!insert(root, root, newnode))
+	    {
+	      pool.returnNode(newnode);
+	    }
+	}
+      else if (operation == LOG_REMOVE)
+	{
+	  if (search(root, value) != NULL)
+	    {
+	      remove(root, root, value, pool);
+	    }
+	}
+      else if (operation == LOG_MULTISET && value == 0)
+	{
+	  // counting off is what every build does anyway
+	}
+      else if (operation == LOG_SEARCH)
+	{
+	  if (search(root, value) != NULL)
+	    {
+	      found++;
+	    }
+	}
+      else
+	{
+	  bad++;
+	}
+    }
+  chrono::steady_clock::time_point end = chrono::steady_clock::now();
+  munmap(data, info.st_size);
+
+  double seconds = chrono::duration<double>(end - start).count();
+  cout << count << " operations in " << seconds * 1000 << " ms";
+  if (seconds > 0)
+    {
+      cout << " (" << (long long)(count / seconds) << " ops/sec)";
+    }
+  cout << ", " << found << " searches found their value, "
+       << pool.getNodesInUse() << " values left" << endl;
+  if (bad > 0)
+    {
+      cerr << bad << " records had an unknown operation" << endl;
+#ifndef RBTREE_MULTISET
+      cerr << "(a log that turns multiset on needs -DRBTREE_MULTISET)"
+	   << endl;
+#endif
+      return 1;
+    }
+  return 0;
+}
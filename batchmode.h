@@ -0,0 +1,44 @@
+#ifndef BATCHMODE_H
+#define BATCHMODE_H
+#include <iostream>
+
+/*
+ * Batch mode runs the tree without the menu, for scripts and pipelines.
+ *
+ * runBatch reads one command per line and prints only results:
+ *   insert 5 7 9       adds values (nothing is printed)
+ *   remove 5           takes values out (nothing is printed)
+ *   search 7           prints 1 if 7 is in the tree, 0 if not
+ *   range 3 10         prints the values from 3 up to (not including) 10
+ *   rank 7             prints how many values are smaller than 7
+ *   select 2           prints the 2nd smallest value, or "none" (rank
+ *                      and select are left out with -DNO_ORDER_STATISTICS)
+ *   size               prints how many values there are
+ *   print              prints the tree the same way the menu does
+ *   clear              empties the tree
+ *   save FILE          writes a snapshot (see snapshot.h)
+ *   load FILE          replaces the tree with a snapshot
+ *   multiset on|off    with -DRBTREE_MULTISET only: while on, repeats
+ *                      are counted (insert adds each line as one batch,
+ *                      remove takes away one copy, search prints the
+ *                      number of copies and size the distinct values)
+ * Blank lines and lines starting with # are skipped. Anything it can't
+ * understand, including anything left on a line after its values, is
+ * reported on cerr with its line number; that line does nothing, and the
+ * rest of the commands still run.
+ *
+ * If recordFile isn't NULL, every insert, remove and search (and every
+ * multiset switch) is also written to it as an operation log that
+ * replayLog can run later.
+ *
+ * An operation log is "RBOP" followed by 8-byte records, each a 32-bit
+ * operation (0 = insert, 1 = remove, 2 = search, 3 = multiset with value
+ * 1 for on and 0 for off) and a 32-bit value. replayLog runs one against
+ * an empty tree and prints how long it took; a log that turns multiset
+ * on can only be replayed by a build with -DRBTREE_MULTISET.
+ */
+
+// functions
+int runBatch(std::istream &in, const char* recordFile);
+int replayLog(const char* filename);
+#endif
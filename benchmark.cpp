@@ -0,0 +1,400 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "node.h"
+#include "nodepool.h"
+#include "redblack.h"
+
+using namespace std;
+
+/*
+ * Description | This is a benchmark program for the red-black tree. It
+ * runs a fixed set of workloads and prints one line of JSON for each, so
+ * runs before and after a change to insert, remove or deleteByCase can
+ * be compared by a script. It is built separately from the interactive
+ * program, out of the same tree files:
+ *
+ *   g++ -O2 -pthread -o benchmark benchmark.cpp redblack.cpp node.cpp
+ *       nodepool.cpp treeiterator.cpp trace.cpp
+ *
+ * Usage | benchmark [count] [seed]
+ * count is the number of operations in each workload (default 1000000)
+ * and seed picks the random numbers (default 1).
+ *
+ * Each line looks like:
+ *   {"workload":"insert_random","ops":1000000,"seconds":1.2,
+ *    "ops_per_sec":830000,"p50_ns":900,"p99_ns":2400,
+ *    "peak_rss_kb":65000,"checksum":1000000}
+ * The latencies come from timing every SAMPLE_EVERY-th operation on its
+ * own (timing all of them would mostly measure the clock). peak_rss_kb is
+ * the most memory the process held during the workload, if the kernel
+ * lets us reset that between workloads, and the most so far otherwise.
+ * checksum counts successful operations, so it should match between runs
+ * with the same count and seed.
+ */
+
+// what one operation does
+enum OperationType
+  {
+    OP_INSERT,
+    OP_REMOVE,
+    OP_SEARCH
+  };
+
+// one operation of a workload, made ahead of time so making it isn't timed
+struct Operation
+{
+  OperationType type;
+  int key;
+};
+
+// time every SAMPLE_EVERY-th operation for the latency numbers
+const int SAMPLE_EVERY = 8;
+
+// FUNCTION PROTOTYPES
+// running and reporting
+void runOperations(const char* name, Node* &root, NodePool &pool,
+		   vector<Operation> &operations);
+void resetPeakMemory();
+long peakMemory();
+
+// workloads
+void insertWorkload(const char* name, vector<int> &keys);
+void lookupWorkload(int count, mt19937 &generator);
+void mixedWorkload(const char* name, int count, int readPercent,
+		   mt19937 &generator);
+void churnWorkload(int count, mt19937 &generator);
+
+// key patterns
+vector<int> zipfianKeys(int count, double skew, mt19937 &generator);
+void fill(Node* &root, NodePool &pool, vector<int> &keys);
+
+int main(int argc, char** argv)
+{
+  int count = 1000000;
+  int seed = 1;
+  if (argc > 1)
+    {
+      count = atoi(argv[1]);
+    }
+  if (argc > 2)
+    {
+      seed = atoi(argv[2]);
+    }
+  if (count <= 0)
+    {
+      cerr << "usage: benchmark [count] [seed]" << endl;
+      return 1;
+    }
+  mt19937 generator(seed);
+
+  // inserts: in order, random, zipfian (lots of repeats), sawtooth
+  vector<int> keys(count);
+  for (int i = 0; i < count; i++)
+    {
+      keys[i] = i;
+    }
+  insertWorkload("insert_sequential", keys);
+  for (int i = 0; i < count; i++)
+    {
+      keys[i] = (int)(generator() & 0x7FFFFFFF);
+    }
+  insertWorkload("insert_random", keys);
+  keys = zipfianKeys(count, 0.99, generator);
+  insertWorkload("insert_zipfian", keys);
+  // runs of 1000 going up, each run starting one above the last one
+  int runLength = 1000;
+  int runs = (count + runLength - 1) / runLength;
+  for (int i = 0; i < count; i++)
+    {
+      keys[i] = (i % runLength) * runs + i / runLength;
+    }
+  insertWorkload("insert_sawtooth", keys);
+
+  lookupWorkload(count, generator);
+  mixedWorkload("mixed_90_read", count, 90, generator);
+  mixedWorkload("mixed_50_read", count, 50, generator);
+  churnWorkload(count, generator);
+  return 0;
+}
+
+/**
+ * This function runs a list of operations on a tree, times them, and
+ * prints the results as one line of JSON.
+ *
+ * @param name | the workload name printed in the results
+ */
+void runOperations(const char* name, Node* &root, NodePool &pool,
+		   vector<Operation> &operations)
+{
+  int count = operations.size();
+  vector<long long> samples;
+  samples.reserve(count / SAMPLE_EVERY + 1);
+  long checksum = 0;
+  resetPeakMemory();
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  chrono::steady_clock::time_point before = start;
+  for (int i = 0; i < count; i++)
+    {
+      bool sampled = (i % SAMPLE_EVERY == 0);
+      if (sampled)
+	{
+	  before = chrono::steady_clock::now();
+	}
+      int key = operations[i].key;
+      if (operations[i].type == OP_INSERT)
+	{
+	  Node* newnode = pool.getNode(key);
+	  if (insert(root, root, newnode))
+	    {
+	      checksum++;
+	    }
+	  else // already there
+	    {
+	      pool.returnNode(newnode);
+	    }
+	}
+      else if (operations[i].type == OP_REMOVE)
+	{
+	  if (search(root, key) != NULL)
+	    {
+	      remove(root, root, key, pool);
+	      checksum++;
+	    }
+	}
+      else if (search(root, key) != NULL)
+	{
+	  checksum++;
+	}
+      if (sampled)
+	{
+	  chrono::steady_clock::time_point after = chrono::steady_clock::now();
+	  samples.push_back(chrono::duration_cast<chrono::nanoseconds>(after - before).count());
+	}
+    }
+  chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+  double seconds = chrono::duration<double>(end - start).count();
+  sort(samples.begin(), samples.end());
+  long long p50 = 0;
+  long long p99 = 0;
+  if (!samples.empty())
+    {
+      p50 = samples[samples.size() / 2];
+      p99 = samples[samples.size() * 99 / 100];
+    }
+  double rate = 0;
+  if (seconds > 0)
+    {
+      rate = count / seconds;
+    }
+  cout << "{\"workload\":\"" << name << "\",\"ops\":" << count
+       << ",\"seconds\":" << seconds
+       << ",\"ops_per_sec\":" << (long long)rate
+       << ",\"p50_ns\":" << p50 << ",\"p99_ns\":" << p99
+       << ",\"peak_rss_kb\":" << peakMemory()
+       << ",\"checksum\":" << checksum << "}" << endl;
+}
+
+// asks Linux to start measuring peak memory again from now; if it can't,
+// the peak just stays the peak since the program started
+void resetPeakMemory()
+{
+  ofstream clearRefs("/proc/self/clear_refs");
+  if (clearRefs)
+    {
+      clearRefs << "5";
+    }
+}
+
+// returns the peak resident memory in KB (VmHWM), or -1 if it can't be read
+long peakMemory()
+{
+  ifstream status("/proc/self/status");
+  char line[256];
+  while (status.getline(line, sizeof(line)))
+    {
+      if (strncmp(line, "VmHWM:", 6) == 0)
+	{
+	  return atol(line + 6);
+	}
+    }
+  return -1;
+}
+
+/**
+ * This function inserts every key in order into an empty tree.
+ */
+void insertWorkload(const char* name, vector<int> &keys)
+{
+  vector<Operation> operations(keys.size());
+  for (size_t i = 0; i < keys.size(); i++)
+    {
+      operations[i].type = OP_INSERT;
+      operations[i].key = keys[i];
+    }
+  Node* root = NULL;
+  NodePool pool;
+  runOperations(name, root, pool, operations);
+}
+
+/**
+ * This function fills a tree with count even numbers, then looks up
+ * count values that are there (lookup_hit) and count odd numbers, which
+ * aren't (lookup_miss), in a random order.
+ */
+void lookupWorkload(int count, mt19937 &generator)
+{
+  vector<int> keys(count);
+  for (int i = 0; i < count; i++)
+    {
+      keys[i] = i * 2;
+    }
+  shuffle(keys.begin(), keys.end(), generator);
+  Node* root = NULL;
+  NodePool pool;
+  fill(root, pool, keys);
+
+  vector<Operation> operations(count);
+  for (int i = 0; i < count; i++)
+    {
+      operations[i].type = OP_SEARCH;
+      operations[i].key = (int)(generator() % count) * 2;
+    }
+  runOperations("lookup_hit", root, pool, operations);
+  for (int i = 0; i < count; i++)
+    {
+      operations[i].key = (int)(generator() % count) * 2 + 1;
+    }
+  runOperations("lookup_miss", root, pool, operations);
+}
+
+/**
+ * This function starts with half of the numbers below 2 * count in the
+ * tree, then runs a mix of lookups (readPercent of the operations) and
+ * writes, which are half inserts and half removes of random numbers in
+ * the same range, so the tree stays about the same size.
+ */
+void mixedWorkload(const char* name, int count, int readPercent,
+		   mt19937 &generator)
+{
+  vector<int> keys(count);
+  for (int i = 0; i < count; i++)
+    {
+      keys[i] = (int)(generator() % ((unsigned)count * 2));
+    }
+  Node* root = NULL;
+  NodePool pool;
+  fill(root, pool, keys);
+
+  vector<Operation> operations(count);
+  for (int i = 0; i < count; i++)
+    {
+      int roll = generator() % 100;
+      if (roll < readPercent)
+	{
+	  operations[i].type = OP_SEARCH;
+	}
+      else if (roll % 2 == 0)
+	{
+	  operations[i].type = OP_INSERT;
+	}
+      else
+	{
+	  operations[i].type = OP_REMOVE;
+	}
+      operations[i].key = (int)(generator() % ((unsigned)count * 2));
+    }
+  runOperations(name, root, pool, operations);
+}
+
+/**
+ * This function fills a tree with count values, then does count
+ * operations where two out of every three remove a value that is in the
+ * tree (in a random order) and the third inserts a new one. Almost every
+ * remove goes through deleteByCase, so this is the workload to watch
+ * after changing it.
+ */
+void churnWorkload(int count, mt19937 &generator)
+{
+  vector<int> keys(count);
+  for (int i = 0; i < count; i++)
+    {
+      keys[i] = i;
+    }
+  shuffle(keys.begin(), keys.end(), generator);
+  Node* root = NULL;
+  NodePool pool;
+  fill(root, pool, keys);
+  shuffle(keys.begin(), keys.end(), generator);
+
+  vector<Operation> operations(count);
+  int removed = 0;
+  int added = 0;
+  for (int i = 0; i < count; i++)
+    {
+      if (i % 3 == 2)
+	{
+	  operations[i].type = OP_INSERT;
+	  operations[i].key = count + added; // never in the tree yet
+	  added++;
+	}
+      else
+	{
+	  operations[i].type = OP_REMOVE;
+	  operations[i].key = keys[removed];
+	  removed++;
+	}
+    }
+  runOperations("churn_remove_heavy", root, pool, operations);
+}
+
+/**
+ * This function returns count keys following a zipfian distribution over
+ * count possible values: the k-th most common value comes up about
+ * 1 / k^skew as often as the most common one. The values are spread out
+ * by a hash so the common ones aren't all next to each other.
+ */
+vector<int> zipfianKeys(int count, double skew, mt19937 &generator)
+{
+  // running totals of the weights, to pick from with a binary search
+  vector<double> totals(count);
+  double total = 0;
+  for (int k = 0; k < count; k++)
+    {
+      total += 1.0 / pow(k + 1, skew);
+      totals[k] = total;
+    }
+  uniform_real_distribution<double> pick(0, total);
+  vector<int> keys(count);
+  for (int i = 0; i < count; i++)
+    {
+      int rank = lower_bound(totals.begin(), totals.end(), pick(generator)) - totals.begin();
+      if (rank >= count) // rounding at the very end
+	{
+	  rank = count - 1;
+	}
+      keys[i] = (int)(((unsigned)rank * 2654435761u) & 0x7FFFFFFF);
+    }
+  return keys;
+}
+
+// inserts keys into the tree without timing anything
+void fill(Node* &root, NodePool &pool, vector<int> &keys)
+{
+  for (size_t i = 0; i < keys.size(); i++)
+    {
+      Node* newnode = pool.getNode(keys[i]);
+      if (!insert(root, root, newnode))
+	{
+	  pool.returnNode(newnode);
+	}
+    }
+}
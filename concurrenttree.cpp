@@ -0,0 +1,378 @@
+#include <iostream>
+#include <thread>
+#include "concurrenttree.h"
+#include "redblack.h"
+
+using namespace std;
+
+// a red-black tree with 2^32 nodes is at most 64 levels tall, so a reader
+// that goes further than this is lost in a tree that is being changed
+static const int MAX_HEIGHT = 128;
+
+// constructor; maxReaders is how many reader threads can be registered
+ConcurrentTree::ConcurrentTree(int newMaxReaders)
+{
+  root = NULL;
+  pool = new NodePool();
+  pool->setHolding(true); // removed nodes wait until readers are done
+  publishedRoot.store(NULL);
+  sequence.store(0);
+  globalEpoch.store(1); // a reader epoch of 0 means "not reading"
+  maxReaders = newMaxReaders;
+  if (maxReaders < 1)
+    {
+      maxReaders = 1;
+    }
+  readers = new ReaderSlot[maxReaders];
+  for (int i = 0; i < maxReaders; i++)
+    {
+      readers[i].epoch.store(0);
+      readers[i].retries.store(0);
+    }
+  readerCount = 0;
+  heldCount = 0;
+}
+
+// destructor; no reader should be running by now
+ConcurrentTree::~ConcurrentTree()
+{
+  for (size_t i = 0; i < retired.size(); i++)
+    {
+      delete retired[i].pool;
+    }
+  delete pool;
+  delete[] readers;
+}
+
+/**
+ * This function adds a value to the tree. The new node is set up before
+ * the write starts, so readers never see it half made.
+ */
+bool ConcurrentTree::insert(int key)
+{
+  lock_guard<mutex> guard(writerLock);
+  Node* newnode = pool->getNode(key);
+  beginWrite();
+  bool added = ::insert(root, root, newnode);
+  if (!added) // already there
+    {
+      pool->returnNode(newnode);
+    }
+  endWrite();
+  return added;
+}
+
+/**
+ * This function removes a value from the tree. The removed node is held
+ * back by the pool instead of going on the free list, and endWrite()
+ * keeps it until every reader that might be on it has finished.
+ */
+bool ConcurrentTree::remove(int key)
+{
+  lock_guard<mutex> guard(writerLock);
+  if (::search(root, key) == NULL)
+    {
+      return false;
+    }
+  beginWrite();
+  ::remove(root, root, key, *pool);
+  endWrite();
+  return true;
+}
+
+/**
+ * This function empties the tree. The old pool can't be deleted while a
+ * reader may still be walking it, so it is retired as a whole and the
+ * tree starts over with a new one.
+ */
+void ConcurrentTree::clear()
+{
+  lock_guard<mutex> guard(writerLock);
+  beginWrite();
+  root = NULL;
+  endWrite();
+
+  // nodes waiting from the old pool go away with it
+  size_t kept = 0;
+  for (size_t i = 0; i < retired.size(); i++)
+    {
+      if (retired[i].pool != NULL)
+	{
+	  retired[kept] = retired[i];
+	  kept++;
+	}
+    }
+  retired.resize(kept);
+  heldCount = 0;
+
+  Retired old;
+  old.epoch = globalEpoch.load();
+  old.nodes = NULL;
+  old.nodeCount = 0;
+  old.pool = pool;
+  retired.push_back(old);
+  globalEpoch.fetch_add(1);
+
+  pool = new NodePool();
+  pool->setHolding(true);
+  reclaim();
+}
+
+// returns a reader number for a new reader thread, or -1 if all are taken
+int ConcurrentTree::addReader()
+{
+  lock_guard<mutex> guard(readerLock);
+  if (readerCount == maxReaders)
+    {
+      return -1;
+    }
+  readerCount++;
+  return readerCount - 1;
+}
+
+/**
+ * This function looks for a key without taking any lock. If a write
+ * happened while it was looking (or it went further down than any real
+ * tree could go) it looks again. If a write is in the middle of
+ * happening, it waits (yielding) for the writer to finish first. Returns
+ * false if reader isn't a number addReader() handed out.
+ *
+ * @param reader | the number from addReader() for this thread
+ */
+bool ConcurrentTree::search(int reader, int key)
+{
+  if (reader < 0 || reader >= maxReaders)
+    {
+      return false;
+    }
+  beginRead(reader);
+  bool found = false;
+  while (true)
+    {
+      uint64_t before = sequence.load(memory_order_acquire);
+      if (before & 1) // a write is going on; let the writer finish
+	{
+	  this_thread::yield();
+	  continue;
+	}
+      Node* current = publishedRoot.load();
+      found = false;
+      int steps = 0;
+      while (current != NULL && steps < MAX_HEIGHT)
+	{
+	  int value = current->loadValue();
+	  if (value == key)
+	    {
+	      found = true;
+	      break;
+	    }
+	  if (key < value)
+	    {
+	      current = current->loadLeft();
+	    }
+	  else
+	    {
+	      current = current->loadRight();
+	    }
+	  steps++;
+	}
+      atomic_thread_fence(memory_order_acquire);
+      if (steps < MAX_HEIGHT &&
+	  sequence.load(memory_order_relaxed) == before)
+	{
+	  break; // nothing changed while we looked
+	}
+      readers[reader].retries.fetch_add(1, memory_order_relaxed);
+    }
+  endRead(reader);
+  return found;
+}
+
+/**
+ * This function copies the values from low up to (but not including) high
+ * into values, stopping after max of them. Like search() it takes no lock
+ * and starts over if a write happened during the scan (or waits for one
+ * that is still going). Returns how many values were copied, or 0 if
+ * reader isn't a number addReader() handed out.
+ *
+ * @param reader | the number from addReader() for this thread
+ */
+int ConcurrentTree::rangeScan(int reader, int low, int high, int* values,
+			      int max)
+{
+  if (reader < 0 || reader >= maxReaders)
+    {
+      return 0;
+    }
+  beginRead(reader);
+  int count = 0;
+  while (true)
+    {
+      uint64_t before = sequence.load(memory_order_acquire);
+      if (before & 1) // a write is going on; let the writer finish
+	{
+	  this_thread::yield();
+	  continue;
+	}
+      Node* current = publishedRoot.load();
+      Node* stack[MAX_HEIGHT]; // nodes >= low whose value isn't copied yet
+      int stackSize = 0;
+      bool lost = false; // the walk went somewhere no real tree goes
+      count = 0;
+      while (!lost)
+	{
+	  // go down to the smallest node >= low under current
+	  int steps = 0;
+	  while (current != NULL && !lost)
+	    {
+	      if (current->loadValue() < low)
+		{
+		  current = current->loadRight();
+		}
+	      else if (stackSize < MAX_HEIGHT)
+		{
+		  stack[stackSize] = current;
+		  stackSize++;
+		  current = current->loadLeft();
+		}
+	      else
+		{
+		  lost = true;
+		}
+	      steps++;
+	      if (steps == MAX_HEIGHT)
+		{
+		  lost = true;
+		}
+	    }
+	  if (lost || stackSize == 0 || count == max)
+	    {
+	      break;
+	    }
+	  stackSize--;
+	  int value = stack[stackSize]->loadValue();
+	  if (value >= high)
+	    {
+	      break;
+	    }
+	  values[count] = value;
+	  count++;
+	  current = stack[stackSize]->loadRight();
+	}
+      atomic_thread_fence(memory_order_acquire);
+      if (!lost &&
+	  sequence.load(memory_order_relaxed) == before)
+	{
+	  break;
+	}
+      readers[reader].retries.fetch_add(1, memory_order_relaxed);
+    }
+  endRead(reader);
+  return count;
+}
+
+// returns how many reads had to be tried again because of a write
+long ConcurrentTree::getRetries()
+{
+  long total = 0;
+  for (int i = 0; i < maxReaders; i++)
+    {
+      total += readers[i].retries.load(memory_order_relaxed);
+    }
+  return total;
+}
+
+// returns how many removed nodes are still waiting for readers
+int ConcurrentTree::getHeldCount()
+{
+  lock_guard<mutex> guard(writerLock);
+  return heldCount;
+}
+
+// makes the sequence number odd so readers know a write is going on
+void ConcurrentTree::beginWrite()
+{
+  sequence.store(sequence.load(memory_order_relaxed) + 1,
+		 memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * This function finishes a write: the new root is published, the sequence
+ * number goes back to even, and any nodes removed during the write are
+ * put aside with the current epoch before the epoch moves on.
+ */
+void ConcurrentTree::endWrite()
+{
+  publishedRoot.store(root);
+  sequence.store(sequence.load(memory_order_relaxed) + 1,
+		 memory_order_release);
+
+  Node* nodes = pool->takeHeld();
+  if (nodes != NULL)
+    {
+      Retired removed;
+      removed.epoch = globalEpoch.load();
+      removed.nodes = nodes;
+      removed.nodeCount = 0;
+      removed.pool = NULL;
+      for (Node* node = nodes; node != NULL; node = node->getLeft())
+	{
+	  removed.nodeCount++;
+	}
+      heldCount += removed.nodeCount;
+      retired.push_back(removed);
+      globalEpoch.fetch_add(1);
+      reclaim();
+    }
+}
+
+// marks the reader as reading in the current epoch
+void ConcurrentTree::beginRead(int reader)
+{
+  readers[reader].epoch.store(globalEpoch.load());
+}
+
+// marks the reader as not reading
+void ConcurrentTree::endRead(int reader)
+{
+  readers[reader].epoch.store(0, memory_order_release);
+}
+
+/**
+ * This function gives back everything that was removed before the oldest
+ * epoch a reader is still in. A reader that started after the removal
+ * began at the new root, so it can't reach those nodes.
+ */
+void ConcurrentTree::reclaim()
+{
+  uint64_t oldest = ~(uint64_t)0;
+  for (int i = 0; i < maxReaders; i++)
+    {
+      uint64_t epoch = readers[i].epoch.load();
+      if (epoch != 0 && epoch < oldest)
+	{
+	  oldest = epoch;
+	}
+    }
+
+  size_t kept = 0;
+  for (size_t i = 0; i < retired.size(); i++)
+    {
+      if (retired[i].epoch >= oldest) // someone may still be looking
+	{
+	  retired[kept] = retired[i];
+	  kept++;
+	}
+      else if (retired[i].pool != NULL)
+	{
+	  delete retired[i].pool;
+	}
+      else
+	{
+	  pool->recycle(retired[i].nodes);
+	  heldCount -= retired[i].nodeCount;
+	}
+    }
+  retired.resize(kept);
+}
@@ -0,0 +1,100 @@
+#ifndef CONCURRENTTREE_H
+#define CONCURRENTTREE_H
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+#include "node.h"
+#include "nodepool.h"
+
+/*
+ * A ConcurrentTree is a red-black tree that many threads can read while
+ * one thread at a time changes it.
+ *
+ * Writers (insert, remove, clear) take a lock, so they go one at a time,
+ * and use the normal tree functions from redblack.h.
+ *
+ * Readers (search, rangeScan) never take a lock. Every write bumps a
+ * sequence number to an odd value before it starts and to the next even
+ * value when it is done. A reader notes the number, walks the tree, and
+ * checks the number again; if a write happened in between (the tree may
+ * have been half way through a rotation) the reader just tries again.
+ * This is not lock-free: a reader that finds the number odd yields and
+ * waits for the write to finish, so a writer that stalls in the middle
+ * of a write stalls every reader with it. Writes are short, so in
+ * practice readers rarely wait, but they never block each other.
+ *
+ * A reader can still be standing on a node that a writer removes, so
+ * removed nodes (and the whole pool, on clear) aren't reused right away.
+ * Each reader announces the "epoch" it started in, and a writer only
+ * recycles nodes that were removed before the oldest epoch any reader is
+ * still in.
+ *
+ * Each reader thread needs its own reader number from addReader(). Reads
+ * with a number that addReader() didn't hand out find nothing.
+ */
+class ConcurrentTree
+{
+ public:
+  // constructors and destructors
+  ConcurrentTree(int maxReaders);
+  ~ConcurrentTree();
+
+  // functions (writers)
+  bool insert(int); // returns false if the value is already there
+  bool remove(int); // returns false if the value wasn't there
+  void clear(); // removes every value
+
+  // functions (readers)
+  int addReader(); // returns a reader number, or -1 if there are none left
+  bool search(int reader, int key); // returns whether the key is there
+  int rangeScan(int reader, int low, int high, int* values, int max);
+
+  // functions (getters)
+  long getRetries(); // returns how many reads had to be tried again
+  int getHeldCount(); // returns how many removed nodes are waiting
+
+ private:
+  // one per reader thread, each on its own cache line
+  struct alignas(64) ReaderSlot
+  {
+    std::atomic<uint64_t> epoch; // 0 when the reader isn't reading
+    std::atomic<long> retries;
+  };
+
+  // removed nodes, or a whole cleared pool, waiting for readers to move on
+  struct Retired
+  {
+    uint64_t epoch; // the epoch they were removed in
+    Node* nodes; // linked through left, or NULL
+    int nodeCount;
+    NodePool* pool; // a cleared pool, or NULL
+  };
+
+  // functions
+  void beginWrite();
+  void endWrite(); // publishes the root and holds back removed nodes
+  void beginRead(int reader);
+  void endRead(int reader);
+  void reclaim();
+
+  // variables
+  Node* root; // the writer's root; readers use publishedRoot
+  NodePool* pool;
+  std::atomic<Node*> publishedRoot;
+  std::atomic<uint64_t> sequence; // odd while a write is in progress
+  std::atomic<uint64_t> globalEpoch;
+  std::mutex writerLock;
+  ReaderSlot* readers;
+  int readerCount;
+  int maxReaders;
+  std::mutex readerLock; // only for handing out reader numbers
+  std::vector<Retired> retired;
+  int heldCount;
+
+  // not copyable
+  ConcurrentTree(const ConcurrentTree&);
+  ConcurrentTree& operator=(const ConcurrentTree&);
+};
+#endif
@@ -0,0 +1,181 @@
+#include <iostream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "filescanner.h"
+
+using namespace std;
+
+// size of each read when the file can't be mapped
+static const size_t BLOCK_SIZE = 1 << 20;
+
+// the longest an int can be in text ("-2147483648"), with room to spare
+static const size_t LONGEST_NUMBER = 32;
+
+// constructor
+FileScanner::FileScanner()
+{
+  fd = -1;
+  mapped = false;
+  mapping = NULL;
+  mappedLength = 0;
+  block = NULL;
+  current = NULL;
+  end = NULL;
+  endOfFile = true;
+}
+
+// destructor, which closes the file if it is still open
+FileScanner::~FileScanner()
+{
+  close();
+}
+
+/**
+ * This function opens a file and maps it into memory. If it can't be
+ * mapped, it gets read a block at a time instead.
+ */
+bool FileScanner::open(const char* filename)
+{
+  close();
+  fd = ::open(filename, O_RDONLY);
+  if (fd < 0)
+    {
+      return false;
+    }
+
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+      void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED)
+	{
+	  // we only go through the file once, front to back
+	  madvise(data, info.st_size, MADV_SEQUENTIAL);
+	  mapped = true;
+	  mapping = (char*)data;
+	  mappedLength = info.st_size;
+	  current = mapping;
+	  end = mapping + mappedLength;
+	  endOfFile = true; // everything is already "read"
+	  return true;
+	}
+    }
+
+  // fall back to reading in blocks
+  block = new char[BLOCK_SIZE];
+  current = block;
+  end = block;
+  endOfFile = false;
+  return true;
+}
+
+/**
+ * This function parses up to max integers into buffer and returns how many
+ * it found. It returns 0 once the whole file has been read.
+ */
+int FileScanner::next(int* buffer, int max)
+{
+  int count = 0;
+  while (count < max)
+    {
+      // when reading in blocks, make sure a whole number is in the buffer
+      if (!endOfFile && (size_t)(end - current) <= LONGEST_NUMBER)
+	{
+	  refill();
+	}
+
+      // skip separators; when reading in blocks, stop short of the end of
+      // the block so a number there can't get cut in half
+      const char* stop = end;
+      if (!endOfFile)
+	{
+	  stop = end - LONGEST_NUMBER;
+	}
+      while (current < stop && (unsigned)(*current - '0') > 9 &&
+	     !(*current == '-' && current + 1 < end &&
+	       (unsigned)(current[1] - '0') <= 9))
+	{
+	  current++;
+	}
+      if (current == end && endOfFile)
+	{
+	  break; // nothing left in the file
+	}
+      if (!endOfFile && current >= stop)
+	{
+	  continue; // get another block first
+	}
+
+      bool negative = (*current == '-');
+      current += negative;
+
+      // build the number one digit at a time
+      unsigned int value = 0;
+      unsigned int digit = (unsigned)(*current - '0');
+      while (digit <= 9)
+	{
+	  value = value * 10 + digit;
+	  current++;
+	  if (current == end)
+	    {
+	      break;
+	    }
+	  digit = (unsigned)(*current - '0');
+	}
+      if (negative)
+	{
+	  value = 0u - value;
+	}
+      buffer[count] = (int)value;
+      count++;
+    }
+  return count;
+}
+
+/**
+ * This function moves whatever is left in the block to the front and
+ * fills the rest from the file. Returns false once the file is used up.
+ */
+bool FileScanner::refill()
+{
+  if (mapped || endOfFile)
+    {
+      return false;
+    }
+  size_t left = end - current;
+  memmove(block, current, left);
+  ssize_t got = read(fd, block + left, BLOCK_SIZE - left);
+  if (got <= 0)
+    {
+      endOfFile = true;
+      got = 0;
+    }
+  current = block;
+  end = block + left + got;
+  return got > 0;
+}
+
+// unmaps and closes the file
+void FileScanner::close()
+{
+  if (mapped)
+    {
+      munmap(mapping, mappedLength);
+    }
+  if (fd >= 0)
+    {
+      ::close(fd);
+    }
+  delete[] block;
+  fd = -1;
+  mapped = false;
+  mapping = NULL;
+  mappedLength = 0;
+  block = NULL;
+  current = NULL;
+  end = NULL;
+  endOfFile = true;
+}
@@ -0,0 +1,41 @@
+#ifndef FILESCANNER_H
+#define FILESCANNER_H
+#include <iostream>
+#include <cstddef>
+
+/*
+ * A FileScanner pulls integers out of a text file much faster than
+ * ifstream >> int. The file is memory-mapped when possible, so the
+ * whole thing is read straight out of the page cache. If mapping fails
+ * (for example on a pipe), the file is read in big blocks instead. The
+ * numbers are parsed by hand without going through locales or streams.
+ * Anything that isn't a digit or a minus sign in front of a digit is
+ * treated as a separator, and values are assumed to fit in an int.
+ */
+class FileScanner
+{
+ public:
+  // constructors and destructors
+  FileScanner();
+  ~FileScanner();
+
+  // functions
+  bool open(const char*); // opens (and maps) a file; false on failure
+  int next(int*, int); // parses up to max values into a buffer
+  void close(); // unmaps and closes the file
+
+ private:
+  // functions
+  bool refill(); // reads the next block when the file isn't mapped
+
+  // variables
+  int fd; // the open file, or -1
+  bool mapped; // whether the file is memory-mapped
+  char* mapping; // start of the mapped file
+  size_t mappedLength;
+  char* block; // buffer for block-by-block reading
+  const char* current; // the next character to look at
+  const char* end; // one past the last character available
+  bool endOfFile; // no more blocks to read
+};
+#endif
@@ -0,0 +1,187 @@
+#include <iostream>
+#include <climits>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "frozentree.h"
+#include "treeiterator.h"
+
+using namespace std;
+
+// keys per block, and children per block
+static const int BLOCK_KEYS = 16;
+static const int BLOCK_CHILDREN = 17;
+
+/**
+ * This function returns how many keys in a block are smaller than key,
+ * which is also which child to go down to next. Unused keys are INT_MAX,
+ * so they are never smaller.
+ */
+static int countSmaller(const int* keys, int key)
+{
+#ifdef __SSE2__
+  __m128i wanted = _mm_set1_epi32(key);
+  const __m128i* lanes = (const __m128i*)keys;
+  __m128i a = _mm_cmplt_epi32(_mm_load_si128(lanes), wanted);
+  __m128i b = _mm_cmplt_epi32(_mm_load_si128(lanes + 1), wanted);
+  __m128i c = _mm_cmplt_epi32(_mm_load_si128(lanes + 2), wanted);
+  __m128i d = _mm_cmplt_epi32(_mm_load_si128(lanes + 3), wanted);
+  // each comparison is all ones or all zeros; pack them down to one byte
+  // per key and take one bit per key
+  __m128i packed = _mm_packs_epi16(_mm_packs_epi32(a, b),
+				   _mm_packs_epi32(c, d));
+  return __builtin_popcount(_mm_movemask_epi8(packed));
+#else
+  int count = 0;
+  for (int i = 0; i < BLOCK_KEYS; i++)
+    {
+      count += (keys[i] < key);
+    }
+  return count;
+#endif
+}
+
+// default constructor
+FrozenTree::FrozenTree()
+{
+  blocks = NULL;
+  positions = NULL;
+  sorted = NULL;
+  blockCount = 0;
+  size = 0;
+}
+
+// destructor
+FrozenTree::~FrozenTree()
+{
+  clear();
+}
+
+/**
+ * This function throws away whatever was frozen before and copies the
+ * values of a tree, walking it in order.
+ */
+void FrozenTree::freeze(Node* root)
+{
+  clear();
+  vector<int> values;
+  for (TreeIterator it = treeBegin(root); it != treeEnd(root); ++it)
+    {
+      values.push_back(*it);
+    }
+  size = values.size();
+  if (size == 0)
+    {
+      return;
+    }
+  sorted = new int[size];
+  for (int i = 0; i < size; i++)
+    {
+      sorted[i] = values[i];
+    }
+  blockCount = (size + BLOCK_KEYS - 1) / BLOCK_KEYS;
+  blocks = new Block[blockCount];
+  positions = new int[blockCount * BLOCK_KEYS];
+  int next = 0;
+  fill(0, next);
+}
+
+// returns whether the key is there
+bool FrozenTree::search(int key)
+{
+  int position = lowerBound(key);
+  return position < size && sorted[position] == key;
+}
+
+/**
+ * This function returns where the first value >= key is in sorted order,
+ * or getSize() if every value is smaller. At each block it remembers the
+ * first key that isn't smaller; anything it finds further down (to the
+ * left of that key) is smaller still, and so a better answer.
+ */
+int FrozenTree::lowerBound(int key)
+{
+  int answer = size;
+  int block = 0;
+  while (block < blockCount)
+    {
+      int smaller = countSmaller(blocks[block].keys, key);
+      if (smaller < BLOCK_KEYS) // padding keys have position size
+	{
+	  answer = positions[block * BLOCK_KEYS + smaller];
+	}
+      block = block * BLOCK_CHILDREN + smaller + 1;
+    }
+  return answer;
+}
+
+/**
+ * This function copies the values from low up to (but not including) high
+ * into values, stopping after max of them. Returns how many it copied.
+ */
+int FrozenTree::rangeScan(int low, int high, int* values, int max)
+{
+  int count = 0;
+  for (int i = lowerBound(low); i < size && sorted[i] < high && count < max;
+       i++)
+    {
+      values[count] = sorted[i];
+      count++;
+    }
+  return count;
+}
+
+// removes every value
+void FrozenTree::clear()
+{
+  delete[] blocks;
+  delete[] positions;
+  delete[] sorted;
+  blocks = NULL;
+  positions = NULL;
+  sorted = NULL;
+  blockCount = 0;
+  size = 0;
+}
+
+// returns the number of values
+int FrozenTree::getSize()
+{
+  return size;
+}
+
+// returns the value at a position in sorted order
+int FrozenTree::getValue(int position)
+{
+  return sorted[position];
+}
+
+/**
+ * This function fills a block and everything below it in order: before
+ * each key come the values of the child to its left. next is the next
+ * sorted value to place. Keys past the last value are set to INT_MAX.
+ */
+void FrozenTree::fill(int block, int &next)
+{
+  if (block >= blockCount)
+    {
+      return;
+    }
+  for (int i = 0; i < BLOCK_KEYS; i++)
+    {
+      fill(block * BLOCK_CHILDREN + i + 1, next);
+      if (next < size)
+	{
+	  blocks[block].keys[i] = sorted[next];
+	  positions[block * BLOCK_KEYS + i] = next;
+	  next++;
+	}
+      else
+	{
+	  blocks[block].keys[i] = INT_MAX;
+	  positions[block * BLOCK_KEYS + i] = size;
+	}
+    }
+  fill(block * BLOCK_CHILDREN + BLOCK_CHILDREN, next);
+}
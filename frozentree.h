@@ -0,0 +1,61 @@
+#ifndef FROZENTREE_H
+#define FROZENTREE_H
+#include <iostream>
+#include "node.h"
+
+/*
+ * A FrozenTree is a read-only copy of a red-black tree laid out for the
+ * cache. The values go into 64-byte blocks of 16 sorted keys, and the
+ * blocks form a static B-tree with 17 children each, stored level by
+ * level in one array (the children of block k are blocks 17k+1 to
+ * 17k+17), so there are no pointers at all. A lookup reads about one
+ * cache line per level, and there are a quarter as many levels as in the
+ * red-black tree. The keys in a block are compared all at once with SSE2
+ * where it is available.
+ *
+ * The sorted values are also kept in a plain array. Range scans find
+ * their first value through the blocks and then read straight along it.
+ *
+ * freeze() rebuilds it from a tree; changing the tree later doesn't
+ * change the FrozenTree.
+ */
+class FrozenTree
+{
+ public:
+  // constructors and destructors
+  FrozenTree();
+  ~FrozenTree();
+
+  // functions
+  void freeze(Node* root); // copies the values of a tree
+  bool search(int key); // returns whether the key is there
+  int lowerBound(int key); // the position of the first value >= key
+  int rangeScan(int low, int high, int* values, int max);
+  void clear(); // removes every value
+
+  // functions (getters)
+  int getSize(); // returns the number of values
+  int getValue(int position); // returns the value at a sorted position
+
+ private:
+  // one cache line of sorted keys; unused keys are INT_MAX
+  struct alignas(64) Block
+  {
+    int keys[16];
+  };
+
+  // functions
+  void fill(int block, int &next); // puts the sorted values in the blocks
+
+  // variables
+  Block* blocks;
+  int* positions; // for each key in the blocks, its place in sorted
+  int* sorted;
+  int blockCount;
+  int size;
+
+  // not copyable
+  FrozenTree(const FrozenTree&);
+  FrozenTree& operator=(const FrozenTree&);
+};
+#endif
@@ -0,0 +1,512 @@
+#include <iostream>
+#include "indextree.h"
+
+using namespace std;
+
+// the top bit of parentColor holds the color
+static const uint32_t BLACK_BIT = 0x80000000;
+
+// constructor
+IndexTree::IndexTree()
+{
+  root = NIL;
+  freeList = NIL;
+  size = 0;
+}
+
+// destructor; the vector cleans itself up
+IndexTree::~IndexTree()
+{
+}
+
+/**
+ * This function adds a new value to the tree. Like insert() in redblack.cpp, it
+ * walks down from the root to a leaf, hangs a red node there and then
+ * fixes any red-black violations.
+ */
+bool IndexTree::insert(int value)
+{
+  uint32_t parent = NIL;
+  uint32_t current = root;
+  while (current != NIL)
+    {
+      parent = current;
+      if (value < nodes[current].data)
+	{
+	  current = nodes[current].left;
+	}
+      else if (value > nodes[current].data)
+	{
+	  current = nodes[current].right;
+	}
+      else // we cannot have two nodes of the same value
+	{
+	  return false;
+	}
+    }
+
+  uint32_t newnode = newNode(value);
+  setParent(newnode, parent);
+  if (parent == NIL) // empty tree
+    {
+      root = newnode;
+    }
+  else if (value < nodes[parent].data)
+    {
+      setLeft(parent, newnode);
+    }
+  else
+    {
+      setRight(parent, newnode);
+    }
+  fixInsert(newnode);
+  return true;
+}
+
+/**
+ * This function fixes violations after an insert. The cases are the same
+ * as fixInsert() in rbcore.h:
+ *
+ * Case 1: the new node is the root; color it black.
+ * Case 2: the parent is black; no violations.
+ * Case 3: parent and uncle are red; recolor and move up to the grandparent.
+ * Case 4: uncle is black and the node is an inner grandchild; rotate
+ * through the parent to turn it into case 5.
+ * Case 5: uncle is black and the node is an outer grandchild; rotate
+ * through the grandparent and swap the parent and grandparent's colors.
+ */
+void IndexTree::fixInsert(uint32_t node)
+{
+  while (true)
+    {
+      // CASE 1
+      if (node == root)
+	{
+	  setColor(node, 'b');
+	  return;
+	}
+
+      // CASE 2
+      uint32_t parent = getParent(node);
+      if (getColor(parent) == 'b')
+	{
+	  return;
+	}
+
+      // a red parent is never the root, so the grandparent exists
+      uint32_t grandparent = getParent(parent);
+      bool parentIsLeft = (nodes[grandparent].left == parent);
+      uint32_t uncle = parentIsLeft ? nodes[grandparent].right
+	: nodes[grandparent].left;
+
+      // CASE 3
+      if (getColor(uncle) == 'r')
+	{
+	  setColor(parent, 'b');
+	  setColor(uncle, 'b');
+	  setColor(grandparent, 'r');
+	  node = grandparent; // fix any new violations further up
+	  continue;
+	}
+
+      // CASE 4: rotate the inner grandchild to the outside
+      if (parentIsLeft && node == nodes[parent].right)
+	{
+	  leftRotation(parent);
+	  node = parent;
+	  parent = getParent(node);
+	}
+      else if (!parentIsLeft && node == nodes[parent].left)
+	{
+	  rightRotation(parent);
+	  node = parent;
+	  parent = getParent(node);
+	}
+
+      // CASE 5: rotate through the grandparent
+      if (parentIsLeft)
+	{
+	  rightRotation(grandparent);
+	}
+      else
+	{
+	  leftRotation(grandparent);
+	}
+      setColor(parent, 'b');
+      setColor(grandparent, 'r');
+      return;
+    }
+}
+
+/**
+ * This function removes a value from the tree. A node with two children
+ * takes the value of the next largest node, and that node (which has at
+ * most one child) is the one that actually gets unlinked.
+ */
+bool IndexTree::remove(int value)
+{
+  uint32_t current = search(value);
+  if (current == NIL)
+    {
+      return false;
+    }
+
+  // the node has two children: swap in the next largest value
+  if (nodes[current].left != NIL && nodes[current].right != NIL)
+    {
+      uint32_t nextLargest = nodes[current].right;
+      while (nodes[nextLargest].left != NIL)
+	{
+	  nextLargest = nodes[nextLargest].left;
+	}
+      nodes[current].data = nodes[nextLargest].data;
+      current = nextLargest;
+    }
+
+  uint32_t child = nodes[current].left;
+  if (child == NIL)
+    {
+      child = nodes[current].right;
+    }
+  uint32_t parent = getParent(current);
+
+  if (child != NIL)
+    {
+      // one child: it must be red, and it takes current's place as black
+      setParent(child, parent);
+      setColor(child, 'b');
+    }
+  else if (getColor(current) == 'b' && current != root)
+    {
+      // a black leaf leaves a hole in the black height; fix it while the
+      // leaf is still attached so it can stand in for the missing node
+      fixRemove(current);
+      parent = getParent(current);
+    }
+
+  // unlink current
+  if (parent == NIL)
+    {
+      root = child;
+    }
+  else if (nodes[parent].left == current)
+    {
+      setLeft(parent, child);
+    }
+  else
+    {
+      setRight(parent, child);
+    }
+
+  // put the slot on the free list
+  nodes[current].left = freeList;
+  nodes[current].right = NIL;
+  nodes[current].parentColor = NIL;
+  freeList = current;
+  size--;
+  return true;
+}
+
+/**
+ * This function fixes a "double black" node after a removal. The cases
+ * are the same ones deleteByCase() in rbcore.h handles:
+ *
+ * Case 1: the node is the root; nothing to do.
+ * Case 2: the sibling is red; rotate it up through the parent.
+ * Case 3: parent, sibling and nieces are black; color the sibling red and
+ * move up to the parent.
+ * Case 4: parent is red, sibling and nieces are black; swap the parent and
+ * sibling's colors.
+ * Case 5: the inner niece is red; rotate through the sibling.
+ * Case 6: the outer niece is red; rotate through the parent.
+ */
+void IndexTree::fixRemove(uint32_t node)
+{
+  while (node != root) // CASE 1 ends the loop
+    {
+      uint32_t parent = getParent(node);
+      bool nodeIsLeft = (nodes[parent].left == node);
+      uint32_t sibling = nodeIsLeft ? nodes[parent].right : nodes[parent].left;
+
+      // CASE 2
+      if (getColor(sibling) == 'r')
+	{
+	  setColor(sibling, 'b');
+	  setColor(parent, 'r');
+	  if (nodeIsLeft)
+	    {
+	      leftRotation(parent);
+	    }
+	  else
+	    {
+	      rightRotation(parent);
+	    }
+	  sibling = nodeIsLeft ? nodes[parent].right : nodes[parent].left;
+	}
+
+      uint32_t inner = nodeIsLeft ? nodes[sibling].left : nodes[sibling].right;
+      uint32_t outer = nodeIsLeft ? nodes[sibling].right : nodes[sibling].left;
+
+      if (getColor(inner) == 'b' && getColor(outer) == 'b')
+	{
+	  setColor(sibling, 'r');
+	  if (getColor(parent) == 'r') // CASE 4
+	    {
+	      setColor(parent, 'b');
+	      return;
+	    }
+	  node = parent; // CASE 3
+	  continue;
+	}
+
+      // CASE 5: turn the red inner niece into a red outer niece
+      if (getColor(outer) == 'b')
+	{
+	  setColor(inner, 'b');
+	  setColor(sibling, 'r');
+	  if (nodeIsLeft)
+	    {
+	      rightRotation(sibling);
+	    }
+	  else
+	    {
+	      leftRotation(sibling);
+	    }
+	  outer = sibling;
+	  sibling = inner;
+	}
+
+      // CASE 6
+      setColor(sibling, getColor(parent));
+      setColor(parent, 'b');
+      setColor(outer, 'b');
+      if (nodeIsLeft)
+	{
+	  leftRotation(parent);
+	}
+      else
+	{
+	  rightRotation(parent);
+	}
+      return;
+    }
+}
+
+/**
+ * This function performs a left rotation around a given node "current."
+ */
+void IndexTree::leftRotation(uint32_t current)
+{
+  uint32_t rotated = nodes[current].right; // this will take current's place
+  uint32_t leftSubtree = nodes[rotated].left;
+  uint32_t parent = getParent(current);
+
+  // the old left subtree becomes current's right subtree
+  setRight(current, leftSubtree);
+  if (leftSubtree != NIL)
+    {
+      setParent(leftSubtree, current);
+    }
+
+  // rotated takes current's place under the grandparent
+  setParent(rotated, parent);
+  if (parent == NIL)
+    {
+      root = rotated;
+    }
+  else if (nodes[parent].left == current)
+    {
+      setLeft(parent, rotated);
+    }
+  else
+    {
+      setRight(parent, rotated);
+    }
+
+  setLeft(rotated, current);
+  setParent(current, rotated);
+}
+
+/**
+ * This function performs a right rotation around a given node "current."
+ */
+void IndexTree::rightRotation(uint32_t current)
+{
+  uint32_t rotated = nodes[current].left; // this will take current's place
+  uint32_t rightSubtree = nodes[rotated].right;
+  uint32_t parent = getParent(current);
+
+  // the old right subtree becomes current's left subtree
+  setLeft(current, rightSubtree);
+  if (rightSubtree != NIL)
+    {
+      setParent(rightSubtree, current);
+    }
+
+  setParent(rotated, parent);
+  if (parent == NIL)
+    {
+      root = rotated;
+    }
+  else if (nodes[parent].left == current)
+    {
+      setLeft(parent, rotated);
+    }
+  else
+    {
+      setRight(parent, rotated);
+    }
+
+  setRight(rotated, current);
+  setParent(current, rotated);
+}
+
+// returns the index holding the value, or NIL if it is not in the tree
+uint32_t IndexTree::search(int value)
+{
+  uint32_t current = root;
+  while (current != NIL && nodes[current].data != value)
+    {
+      if (value < nodes[current].data)
+	{
+	  current = nodes[current].left;
+	}
+      else
+	{
+	  current = nodes[current].right;
+	}
+    }
+  return current;
+}
+
+// displays the tree sideways
+void IndexTree::print()
+{
+  print(root, 0);
+}
+
+void IndexTree::print(uint32_t current, int numTabs)
+{
+  if (current == NIL)
+    {
+      return;
+    }
+  numTabs += 1;
+  print(nodes[current].right, numTabs);
+  cout << endl;
+  for (int i = 1; i < numTabs; i++)
+    {
+      cout << "\t";
+    }
+  cout << nodes[current].data << " (" << getColor(current) << ") " << "\n";
+  print(nodes[current].left, numTabs);
+}
+
+// removes every node
+void IndexTree::clear()
+{
+  nodes.clear();
+  root = NIL;
+  freeList = NIL;
+  size = 0;
+}
+
+// makes room for this many nodes so the vector doesn't keep regrowing
+void IndexTree::reserve(int count)
+{
+  nodes.reserve(count);
+}
+
+// takes a slot off the free list, or adds one to the end of the array
+uint32_t IndexTree::newNode(int value)
+{
+  uint32_t index = freeList;
+  if (index != NIL)
+    {
+      freeList = nodes[index].left;
+    }
+  else
+    {
+      index = nodes.size();
+      nodes.push_back(IndexNode());
+    }
+  nodes[index].data = value;
+  nodes[index].left = NIL;
+  nodes[index].right = NIL;
+  nodes[index].parentColor = NIL; // no parent, red
+  size++;
+  return index;
+}
+
+uint32_t IndexTree::getRoot()
+{
+  return root;
+}
+
+int IndexTree::getSize()
+{
+  return size;
+}
+
+int IndexTree::getValue(uint32_t index)
+{
+  return nodes[index].data;
+}
+
+uint32_t IndexTree::getLeft(uint32_t index)
+{
+  return nodes[index].left;
+}
+
+uint32_t IndexTree::getRight(uint32_t index)
+{
+  return nodes[index].right;
+}
+
+uint32_t IndexTree::getParent(uint32_t index)
+{
+  return nodes[index].parentColor & ~BLACK_BIT;
+}
+
+// NIL links are leaves, and leaves are black
+char IndexTree::getColor(uint32_t index)
+{
+  if (index == NIL || (nodes[index].parentColor & BLACK_BIT))
+    {
+      return 'b';
+    }
+  return 'r';
+}
+
+vector<IndexNode>& IndexTree::getNodes()
+{
+  return nodes;
+}
+
+void IndexTree::setLeft(uint32_t index, uint32_t newleft)
+{
+  nodes[index].left = newleft;
+}
+
+void IndexTree::setRight(uint32_t index, uint32_t newright)
+{
+  nodes[index].right = newright;
+}
+
+// set the parent, keeping the color bit as it was
+void IndexTree::setParent(uint32_t index, uint32_t newparent)
+{
+  nodes[index].parentColor = newparent | (nodes[index].parentColor & BLACK_BIT);
+}
+
+void IndexTree::setColor(uint32_t index, char newcolor)
+{
+  if (newcolor == 'b')
+    {
+      nodes[index].parentColor |= BLACK_BIT;
+    }
+  else
+    {
+      nodes[index].parentColor &= ~BLACK_BIT;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef INDEXTREE_H
+#define INDEXTREE_H
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+
+/*
+ * A node in an IndexTree. Instead of pointers, the links are 32-bit
+ * positions in the tree's node array, so a whole node is 16 bytes.
+ * The color is kept in the top bit of the parent link (1 = black).
+ */
+struct IndexNode
+{
+  int data;
+  uint32_t left;
+  uint32_t right;
+  uint32_t parentColor;
+};
+
+/*
+ * IndexTree is a red-black tree whose nodes all live in one contiguous
+ * vector. It follows the same cases as the pointer-based tree in redblack.cpp,
+ * but left, right and parent are indexes instead of Node pointers. Since
+ * nothing in the array is a pointer, it can be copied or written to disk
+ * as-is.
+ */
+class IndexTree
+{
+ public:
+  // the "null" link
+  static const uint32_t NIL = 0x7FFFFFFF;
+
+  // constructors and destructors
+  IndexTree();
+  ~IndexTree();
+
+  // functions
+  bool insert(int); // adds a value; false if it is already there
+  bool remove(int); // removes a value; false if it isn't there
+  uint32_t search(int); // returns the index holding the value, or NIL
+  void print(); // displays the tree sideways like print() in redblack.cpp
+  void clear(); // removes every node
+  void reserve(int); // makes room for this many nodes up front
+
+  // functions (getters)
+  uint32_t getRoot(); // returns the index of the root, or NIL
+  int getSize(); // returns the number of values in the tree
+  int getValue(uint32_t); // returns the value stored at an index
+  uint32_t getLeft(uint32_t); // returns the left child's index
+  uint32_t getRight(uint32_t); // returns the right child's index
+  uint32_t getParent(uint32_t); // returns the parent's index
+  char getColor(uint32_t); // returns 'r' or 'b'; NIL counts as black
+  std::vector<IndexNode>& getNodes(); // the raw node array
+
+ private:
+  // functions (setters)
+  void setLeft(uint32_t, uint32_t);
+  void setRight(uint32_t, uint32_t);
+  void setParent(uint32_t, uint32_t);
+  void setColor(uint32_t, char);
+
+  // functions
+  uint32_t newNode(int); // takes a slot off the free list or the end
+  void fixInsert(uint32_t);
+  void fixRemove(uint32_t);
+  void leftRotation(uint32_t);
+  void rightRotation(uint32_t);
+  void print(uint32_t, int);
+
+  // variables
+  std::vector<IndexNode> nodes;
+  uint32_t root;
+  uint32_t freeList; // removed slots, linked through their left links
+  int size;
+};
+#endif
@@ -0,0 +1,389 @@
+#include <iostream>
+#include <climits>
+#include "intervaltree.h"
+#include "rbcore.h"
+#include "trace.h"
+
+using namespace std;
+
+// regular constructor; a new node is red, with nothing around it
+IntervalNode::IntervalNode(int newlow, int newhigh, int newid)
+{
+  low = newlow;
+  high = newhigh;
+  id = newid;
+  maxHigh = newhigh;
+  color = 'r';
+  left = NULL;
+  right = NULL;
+  parent = NULL;
+}
+
+// returns where the interval starts
+int IntervalNode::getLow()
+{
+  return low;
+}
+
+// returns where the interval ends
+int IntervalNode::getHigh()
+{
+  return high;
+}
+
+// returns the id it was added with
+int IntervalNode::getId()
+{
+  return id;
+}
+
+// returns the largest high in this node's subtree
+int IntervalNode::getMaxHigh()
+{
+  return maxHigh;
+}
+
+// returns either 'r' or 'b'
+char IntervalNode::getColor()
+{
+  return color;
+}
+
+// returns left child
+IntervalNode* IntervalNode::getLeft()
+{
+  return left;
+}
+
+// returns right child
+IntervalNode* IntervalNode::getRight()
+{
+  return right;
+}
+
+// returns the parent node
+IntervalNode* IntervalNode::getParent()
+{
+  return parent;
+}
+
+// moves an interval into this node (maxHigh is left for the caller)
+void IntervalNode::setInterval(int newlow, int newhigh, int newid)
+{
+  low = newlow;
+  high = newhigh;
+  id = newid;
+}
+
+// sets the largest high in this node's subtree
+void IntervalNode::setMaxHigh(int newmax)
+{
+  maxHigh = newmax;
+}
+
+// sets the color
+void IntervalNode::setColor(char newcolor)
+{
+  color = newcolor;
+}
+
+// establishes left child
+void IntervalNode::setLeft(IntervalNode* newleft)
+{
+  left = newleft;
+}
+
+// establishes right child
+void IntervalNode::setRight(IntervalNode* newright)
+{
+  right = newright;
+}
+
+// sets the parent node
+void IntervalNode::setParent(IntervalNode* newparent)
+{
+  parent = newparent;
+}
+
+// returns the largest high in a subtree (INT_MIN if it is empty)
+static int maxHighOf(IntervalNode* node)
+{
+  if (node == NULL)
+    {
+      return INT_MIN;
+    }
+  return node->getMaxHigh();
+}
+
+/**
+ * This function works out a node's maxHigh from its own high and its
+ * children's. The rotations in rbcore.h call it on the two nodes they
+ * move, and remove() calls it on the way up from the leaving node.
+ */
+void updateNode(IntervalNode* node)
+{
+  int most = node->getHigh();
+  if (maxHighOf(node->getLeft()) > most)
+    {
+      most = maxHighOf(node->getLeft());
+    }
+  if (maxHighOf(node->getRight()) > most)
+    {
+      most = maxHighOf(node->getRight());
+    }
+  node->setMaxHigh(most);
+}
+
+// returns the int that TRACE records for a node
+int traceKey(IntervalNode* node)
+{
+  return node->getLow();
+}
+
+// returns whether [low, high] with this id comes before the node's interval
+static bool comesBefore(int low, int high, int id, IntervalNode* node)
+{
+  if (low != node->getLow())
+    {
+      return low < node->getLow();
+    }
+  if (high != node->getHigh())
+    {
+      return high < node->getHigh();
+    }
+  return id < node->getId();
+}
+
+// returns whether the node holds exactly this interval and id
+static bool holds(IntervalNode* node, int low, int high, int id)
+{
+  return node->getLow() == low && node->getHigh() == high &&
+    node->getId() == id;
+}
+
+// returns the child on the side [low, high] with this id belongs on
+static IntervalNode* childToward(IntervalNode* node, int low, int high,
+				 int id)
+{
+  if (comesBefore(low, high, id, node))
+    {
+      return node->getLeft();
+    }
+  return node->getRight();
+}
+
+// default constructor
+IntervalTree::IntervalTree()
+{
+  root = NULL;
+  size = 0;
+}
+
+// destructor
+IntervalTree::~IntervalTree()
+{
+  clear();
+}
+
+/**
+ * This function adds an interval. Every node passed on the way down gets
+ * the new high in its maxHigh, then fixInsert() balances the tree.
+ */
+bool IntervalTree::insert(int low, int high, int id)
+{
+  if (low > high)
+    {
+      return false;
+    }
+  IntervalNode* parent = NULL;
+  IntervalNode* current = root;
+  while (current != NULL)
+    {
+      if (holds(current, low, high, id))
+	{
+	  TRACE(TRACE_INSERT_DUPLICATE, low);
+	  return false; // nothing was raised, since high <= maxHigh here
+	}
+      if (high > current->getMaxHigh())
+	{
+	  current->setMaxHigh(high);
+	}
+      parent = current;
+      current = childToward(current, low, high, id);
+    }
+
+  IntervalNode* newnode = new IntervalNode(low, high, id);
+  newnode->setParent(parent);
+  if (parent == NULL)
+    {
+      root = newnode;
+    }
+  else if (comesBefore(low, high, id, parent))
+    {
+      parent->setLeft(newnode);
+    }
+  else
+    {
+      parent->setRight(newnode);
+    }
+  fixInsert(root, newnode);
+  size++;
+  return true;
+}
+
+/**
+ * This function removes an interval. A node with two children takes its
+ * successor's interval and the successor leaves instead, like remove()
+ * does. The leaving node's high is dropped out of maxHigh on the way up
+ * to the root first, so the rotations in the fix-up already see the tree
+ * without it; then unlinkNode() balances the tree and takes it out.
+ */
+bool IntervalTree::remove(int low, int high, int id)
+{
+  IntervalNode* found = root;
+  while (found != NULL && !holds(found, low, high, id))
+    {
+      found = childToward(found, low, high, id);
+    }
+  if (found == NULL)
+    {
+      return false;
+    }
+
+  IntervalNode* leaving = found;
+  if (found->getLeft() != NULL && found->getRight() != NULL)
+    {
+      TRACE(TRACE_REMOVE_TWO_CHILDREN, low);
+      leaving = found->getRight();
+      while (leaving->getLeft() != NULL)
+	{
+	  leaving = leaving->getLeft();
+	}
+      found->setInterval(leaving->getLow(), leaving->getHigh(),
+			 leaving->getId());
+    }
+
+  // the leaving node no longer counts toward any maxHigh (found is on
+  // this path too, so its new interval is taken in)
+  leaving->setInterval(leaving->getLow(), INT_MIN, leaving->getId());
+  for (IntervalNode* above = leaving; above != NULL;
+       above = above->getParent())
+    {
+      updateNode(above);
+    }
+  unlinkNode(root, leaving);
+  delete leaving;
+  size--;
+  return true;
+}
+
+// removes every interval
+void IntervalTree::clear()
+{
+  deleteSubtree(root);
+  root = NULL;
+  size = 0;
+}
+
+/**
+ * This function visits every interval that contains point (including at
+ * either end). Returns how many there were.
+ */
+int IntervalTree::stab(int point, void (*visit)(IntervalNode*, void*),
+		       void* data)
+{
+  return overlapBelow(root, point, point, visit, data);
+}
+
+/**
+ * This function visits every interval that shares at least one point
+ * with [low, high]. Returns how many there were.
+ */
+int IntervalTree::overlap(int low, int high,
+			  void (*visit)(IntervalNode*, void*), void* data)
+{
+  if (low > high)
+    {
+      return 0;
+    }
+  return overlapBelow(root, low, high, visit, data);
+}
+
+/**
+ * This function returns some interval that overlaps [low, high], or NULL
+ * if none does, going down just one path: if the left subtree reaches as
+ * far as low, then either something in it overlaps or nothing in the
+ * right subtree (which all starts later) can.
+ */
+IntervalNode* IntervalTree::findOverlap(int low, int high)
+{
+  IntervalNode* current = root;
+  while (current != NULL)
+    {
+      if (current->getLow() <= high && current->getHigh() >= low)
+	{
+	  return current;
+	}
+      if (current->getLeft() != NULL &&
+	  current->getLeft()->getMaxHigh() >= low)
+	{
+	  current = current->getLeft();
+	}
+      else
+	{
+	  current = current->getRight();
+	}
+    }
+  return NULL;
+}
+
+// returns the number of intervals
+int IntervalTree::getSize()
+{
+  return size;
+}
+
+// returns the root, or NULL if the tree is empty
+IntervalNode* IntervalTree::getRoot()
+{
+  return root;
+}
+
+/**
+ * This function visits the intervals under node that overlap [low, high]
+ * in order. A subtree whose maxHigh is below low has nothing to offer,
+ * and once a node starts after high, so does everything to its right.
+ */
+int IntervalTree::overlapBelow(IntervalNode* node, int low, int high,
+			       void (*visit)(IntervalNode*, void*),
+			       void* data)
+{
+  int count = 0;
+  while (node != NULL && node->getMaxHigh() >= low)
+    {
+      count += overlapBelow(node->getLeft(), low, high, visit, data);
+      if (node->getLow() > high)
+	{
+	  break;
+	}
+      if (node->getHigh() >= low)
+	{
+	  visit(node, data);
+	  count++;
+	}
+      node = node->getRight(); // the right side goes on in this loop
+    }
+  return count;
+}
+
+// deletes every node in a subtree
+void IntervalTree::deleteSubtree(IntervalNode* node)
+{
+  while (node != NULL)
+    {
+      deleteSubtree(node->getLeft());
+      IntervalNode* right = node->getRight();
+      delete node;
+      node = right;
+    }
+}
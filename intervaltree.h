@@ -0,0 +1,104 @@
+#ifndef INTERVALTREE_H
+#define INTERVALTREE_H
+#include <iostream>
+
+/*
+ * A node in an IntervalTree: the interval [low, high], the id it was added
+ * with, and the largest high anywhere in this node's subtree.
+ */
+class IntervalNode
+{
+ public:
+  // constructors and destructors
+  IntervalNode(int newlow, int newhigh, int newid);
+
+  // functions (getters)
+  int getLow(); // returns where the interval starts
+  int getHigh(); // returns where the interval ends
+  int getId(); // returns the id it was added with
+  int getMaxHigh(); // returns the largest high in this node's subtree
+  char getColor(); // returns either 'r' or 'b' for red or black
+  IntervalNode* getLeft(); // returns left child
+  IntervalNode* getRight(); // returns right child
+  IntervalNode* getParent(); // returns the parent node
+
+  // functions (setters)
+  void setInterval(int newlow, int newhigh, int newid); // move an interval here
+  void setMaxHigh(int); // set the largest high in this node's subtree
+  void setColor(char); // set the color of the node
+  void setLeft(IntervalNode*); // establish left child
+  void setRight(IntervalNode*); // establish right child
+  void setParent(IntervalNode*); // set the parent node
+
+ private:
+  // variables
+  int low;
+  int high;
+  int id;
+  int maxHigh;
+  char color;
+  IntervalNode* left;
+  IntervalNode* right;
+  IntervalNode* parent;
+};
+
+// what rbcore.h needs for IntervalNode: the rotations keep maxHigh right
+// through updateNode, and TRACE records the node's low
+void updateNode(IntervalNode* node);
+int traceKey(IntervalNode* node);
+
+/*
+ * An IntervalTree is a red-black tree of closed intervals [low, high],
+ * ordered by low, then high, then id, where every node also knows the
+ * largest high below it. The balancing is the shared code in rbcore.h:
+ * its rotations work out maxHigh again for the two nodes they move
+ * (through updateNode), the same way they fix subtree sizes for Node.
+ * Insert raises maxHigh on the way down and remove takes the leaving
+ * interval out of maxHigh before the fix-up, like adjustSizes() does for
+ * sizes.
+ *
+ * The id tells apart intervals with the same ends, so the same range can
+ * be added more than once as long as each copy has its own id; only an
+ * exact repeat of low, high and id is turned away.
+ *
+ * maxHigh lets the queries skip any subtree that ends before the point or
+ * range they want, so they cost O(log n) plus a little for each interval
+ * they report.
+ */
+class IntervalTree
+{
+ public:
+  // constructors and destructors
+  IntervalTree();
+  ~IntervalTree();
+
+  // functions
+  bool insert(int low, int high, int id = 0); // false if already there or low > high
+  bool remove(int low, int high, int id = 0); // false if it wasn't there
+  void clear(); // removes every interval
+
+  // queries; each returns how many intervals it visited
+  int stab(int point, void (*visit)(IntervalNode*, void*), void* data);
+  int overlap(int low, int high, void (*visit)(IntervalNode*, void*),
+	      void* data);
+  IntervalNode* findOverlap(int low, int high); // any one, or NULL
+
+  // functions (getters)
+  int getSize(); // returns the number of intervals
+  IntervalNode* getRoot();
+
+ private:
+  // functions
+  int overlapBelow(IntervalNode* node, int low, int high,
+		   void (*visit)(IntervalNode*, void*), void* data);
+  void deleteSubtree(IntervalNode* node);
+
+  // variables
+  IntervalNode* root;
+  int size;
+
+  // not copyable
+  IntervalTree(const IntervalTree&);
+  IntervalTree& operator=(const IntervalTree&);
+};
+#endif
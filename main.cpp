@@ -1,7 +1,27 @@
 #include <iostream>
-#include <cstring>
 #include <fstream>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+#include <vector>
 #include "node.h"
+#include "nodepool.h"
+#include "treeiterator.h"
+#include "trace.h"
+#include "filescanner.h"
+#include "snapshot.h"
+#include "redblack.h"
+#include "concurrenttree.h"
+#include "shardedtree.h"
+#include "perfcounter.h"
+#include "batchmode.h"
+#include "persistenttree.h"
+#include "frozentree.h"
+#include "intervaltree.h"
 
 using namespace std;
 
@@ -15,41 +35,112 @@ using namespace std;
  */
 
 
-// RED BLACK TREE CONDITIONS
-/*
- * Node is either red or black
- * root is black
- * all "leaves" (null children) are black
- * every red node has 2 black children
- * every path from root to leaf has the same number of black nodes
- */
-
 // FUNCTION PROTOTYPES
-// insertion
-void insert(Node* &root, Node* current,  Node* newnode);
-void fixInsert(Node* &root, Node* newnode);
-
-// general operations
-void rightRotation(Node* current, Node* &root);
-void leftRotation(Node* current, Node* &root);
-void print(Node* current, int numTabs);
-int childStatus(Node* node);
-Node* getUncle(Node* node);
-Node* getSibling(Node* node);
-Node* search(Node* current, int searchkey);
-void swapColor(Node* a, Node* b);
-
-// deletion
-void remove(Node* &root, Node* current, Node* parent, int searchkey);
-void fixRemove(Node* &root, Node* node, Node* deleted);
-void deleteByCase(Node* node, Node* deleted, Node* &root);
-
-int main()
+// the tree operations themselves are declared in redblack.h
+
+// file input
+int* readFile(char* filename, int &count);
+void loadFileParallel(Node* &root, char* filename, NodePool &pool);
+
+// timing
+void benchmarkTree(int count);
+void benchmarkReaders(int readerThreads, int count);
+void benchmarkSequential(int count);
+void readerLoop(ConcurrentTree* tree, int count, atomic<bool>* stop,
+		long* lookups, long* wrong);
+void benchmarkShards(int count, int maxThreads);
+void insertSlice(ShardedTree* tree, int* keys, int count);
+void benchmarkVersions(int count);
+void reportLoop(PersistentNode* snapshot, int count, atomic<bool>* stop,
+		long* reports, long* wrong);
+
+// range queries
+void printVisited(Node* node, void* data);
+
+// read-optimized copies
+void benchmarkFrozen(Node* root);
+void countVisited(Node* node, void* data);
+
+// interval trees
+void benchmarkIntervals(int count);
+void countIntervals(IntervalNode* node, void* data);
+
+/**
+ * Without arguments the program shows the menu. It can also run without
+ * any prompts (see batchmode.h):
+ *   main --batch [FILE] [--record LOG]   runs commands from FILE (or stdin)
+ *   main --replay LOG                    runs an operation log and times it
+ */
+int main(int argc, char** argv)
 {
+  if (argc > 1)
+    {
+      const char* script = NULL;
+      const char* recordFile = NULL;
+      bool batch = false;
+      for (int i = 1; i < argc; i++)
+	{
+	  if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+	    {
+	      return replayLog(argv[i + 1]);
+	    }
+	  else if (strcmp(argv[i], "--batch") == 0)
+	    {
+	      batch = true;
+	    }
+	  else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+	    {
+	      recordFile = argv[i + 1];
+	      i++;
+	    }
+	  else if (batch && script == NULL && argv[i][0] != '-')
+	    {
+	      script = argv[i];
+	    }
+	  else if (batch && script == NULL && strcmp(argv[i], "-") == 0)
+	    {
+	      script = NULL; // stdin
+	    }
+	  else
+	    {
+	      cerr << "usage: " << argv[0]
+		   << " [--batch [FILE|-] [--record LOG] | --replay LOG]" << endl;
+	      return 2;
+	    }
+	}
+      if (!batch)
+	{
+	  cerr << "usage: " << argv[0]
+	       << " [--batch [FILE|-] [--record LOG] | --replay LOG]" << endl;
+	  return 2;
+	}
+      ios::sync_with_stdio(false); // nothing else is printing
+      int errors = 0;
+      if (script == NULL)
+	{
+	  errors = runBatch(cin, recordFile);
+	}
+      else
+	{
+	  ifstream file(script);
+	  if (!file)
+	    {
+	      cerr << "could not open " << script << endl;
+	      return 1;
+	    }
+	  errors = runBatch(file, recordFile);
+	}
+      return errors == 0 ? 0 : 1;
+    }
+
   int max = 50;
   char input[max];
   bool running = true;
   Node* root = NULL;
+  NodePool pool; // owns every node in the tree
+#ifdef RBTREE_MULTISET
+  bool counting = false; // multiset mode: repeated values are counted
+#endif
 
   // the program will loop until the user wants to quit
   while (running)
@@ -64,6 +155,28 @@ int main()
       cout << "To remove nodes, type 'remove.'" << endl;
       cout << "To visualize your tree, type 'print'" << endl;
       cout << "To find a value in the tree, type 'search.'" << endl;
+      cout << "To list the values in a range, type 'range.'" << endl;
+#ifndef NO_ORDER_STATISTICS
+      cout << "To find how many values are below a number, type 'rank.'" << endl;
+      cout << "To find the k-th smallest value, type 'select.'" << endl;
+#endif
+      cout << "To split the tree at a value and join it back, type 'split.'" << endl;
+      cout << "To freeze the tree into a read-only copy and time it, type 'freeze.'" << endl;
+      cout << "To delete the whole tree, type 'clear.'" << endl;
+      cout << "To time inserts and lookups on a test tree, type 'benchmark.'" << endl;
+      cout << "To compare the insert functions on keys in order, type 'sequential.'" << endl;
+      cout << "To time readers that take no lock running next to a writer, type 'readers.'" << endl;
+      cout << "To time a sharded tree with more and more threads, type 'shards.'" << endl;
+      cout << "To time writes while a report reads an old version, type 'versions.'" << endl;
+#ifdef RBTREE_MULTISET
+      cout << "To count repeated values instead of rejecting them, type 'multiset.'" << endl;
+#endif
+      cout << "To time interval queries against a linear scan, type 'intervals.'" << endl;
+      cout << "To save the tree to a file, type 'save.'" << endl;
+      cout << "To load a saved tree, type 'load.'" << endl;
+#ifdef RBTREE_TRACE
+      cout << "To see which rebalancing cases have run, type 'trace.'" << endl;
+#endif
 
       cin.getline(input, max);
 
@@ -76,6 +189,8 @@ int main()
 	{
 	  cout << "to insert a single number, type 'add.'" << endl;
 	  cout << "to read in a file, type 'read.'" << endl;
+	  cout << "to read in a sorted file all at once, type 'bulk.'" << endl;
+	  cout << "to read in an unsorted file using every core, type 'parallel.'" << endl;
 	  cin.getline(input, max);
 	  if (strcmp(input, "add") == 0)
 	    {
@@ -83,8 +198,24 @@ int main()
 	      int newnum = 0;
 	      cin >> newnum;
 	      cin.ignore(max, '\n');
-	      Node* newnode = new Node(newnum);
-	      insert(root, root, newnode);
+#ifdef RBTREE_MULTISET
+	      if (counting) // repeats just raise the count
+		{
+		  int copies = insertCounted(root, newnum, pool);
+		  cout << newnum << " is in the tree " << copies << (copies == 1 ? " time." : " times.") << endl;
+		}
+	      else
+#endif
+		{
+		  Node* newnode = pool.getNode(newnum);
+		  if (!insert(root, root, newnode))
+		    {
+		      // we cannot have two nodes of the same value
+		      cout << "Two nodes of the same value cannot be added." << endl;
+		      cout << "Therefore the node " << newnum << " cannot be added more than once." << endl;
+		      pool.returnNode(newnode);
+		    }
+		}
 	      print(root, 0);
 	    }
 	  else if (strcmp(input, "read") == 0)
@@ -92,16 +223,126 @@ int main()
 	      // read in the file
 	      cout << "What is the name of the file you want to read in?" << endl;
 	      cin.getline(input, max);
-	      ifstream inFile;
-	      inFile.open(input);
-	      int newnum = 0; // temporarily keeps track of values
-	      while (inFile >> newnum)
+	      FileScanner scanner;
+	      if (!scanner.open(input))
+		{
+		  cout << "The file could not be opened." << endl;
+		}
+	      else
+		{
+		  // the values are parsed and inserted in batches
+		  int batchSize = 65536;
+		  int* batch = new int[batchSize];
+		  int batchCount = 0;
+		  int skipped = 0; // values that were already in the tree
+		  int repeats = 0; // or, in multiset mode, that were counted
+		  while ((batchCount = scanner.next(batch, batchSize)) > 0)
+		    {
+#ifdef RBTREE_MULTISET
+		      if (counting)
+			{
+			  repeats += insertBatchCounted(root, batch, batchCount, pool);
+			  continue;
+			}
+#endif
+		      skipped += insertBatch(root, batch, batchCount, pool);
+		    }
+		  delete[] batch;
+		  scanner.close();
+		  if (repeats > 0)
+		    {
+		      cout << repeats << " values were repeats and were counted." << endl;
+		    }
+		  if (skipped > 0)
+		    {
+		      cout << skipped << " values were already in the tree and were not added again." << endl;
+		    }
+		  print(root, 0); // print out the tree after insertion
+		}
+	    }
+	  else if (strcmp(input, "bulk") == 0)
+	    {
+	      // read the whole file first so it can be checked for order
+	      cout << "What is the name of the sorted file you want to read in?" << endl;
+	      cin.getline(input, max);
+	      int count = 0;
+	      int* values = readFile(input, count);
+#ifdef RBTREE_MULTISET
+	      if (counting) // keep the repeats; this also handles any order
+		{
+		  int repeats = insertBatchCounted(root, values, count, pool);
+		  cout << repeats << " values were repeats and were counted." << endl;
+		}
+	      else
+#endif
+	      if (root != NULL || !isSorted(values, count))
+		{
+		  // bulk building only works on an empty tree and sorted input
+		  cout << "The tree is not empty or the file is not sorted." << endl;
+		  cout << "The values will be inserted one at a time." << endl;
+		  for (int i = 0; i < count; i++)
+		    {
+		      Node* newnode = pool.getNode(values[i]);
+		      if (!insert(root, root, newnode)) // already there
+			{
+			  pool.returnNode(newnode);
+			}
+		    }
+		}
+	      else
+		{
+		  // time the bulk build against the old one-at-a-time loop
+		  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		  int skipped = buildSorted(root, values, count, pool);
+		  chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+		  Node* compare = NULL; // throwaway tree built the old way
+		  NodePool comparePool;
+		  for (int i = 0; i < count; i++)
+		    {
+		      Node* newnode = comparePool.getNode(values[i]);
+		      insert(compare, compare, newnode);
+		    }
+		  chrono::steady_clock::time_point end = chrono::steady_clock::now();
+		  comparePool.clear(); // throw the whole comparison tree away
+		  cout << "Bulk build of " << count << " nodes: "
+		       << chrono::duration<double, milli>(middle - start).count()
+		       << " ms" << endl;
+		  cout << "One-at-a-time insert of " << count << " nodes: "
+		       << chrono::duration<double, milli>(end - middle).count()
+		       << " ms" << endl;
+		  if (skipped > 0)
+		    {
+		      cout << skipped << " repeated values were skipped." << endl;
+		    }
+		}
+	      delete[] values;
+	      print(root, 0);
+	    }
+	  else if (strcmp(input, "parallel") == 0)
+	    {
+	      cout << "What is the name of the file you want to read in?" << endl;
+	      cin.getline(input, max);
+#ifdef RBTREE_MULTISET
+	      if (counting) // the parallel load drops repeats; count them instead
+		{
+		  int count = 0;
+		  int* values = readFile(input, count);
+		  int repeats = insertBatchCounted(root, values, count, pool);
+		  cout << repeats << " values were repeats and were counted." << endl;
+		  delete[] values;
+		  print(root, 0);
+		}
+	      else
+#endif
+	      if (root != NULL)
+		{
+		  cout << "The tree has to be empty for a parallel load." << endl;
+		}
+	      else
 		{
-		  Node* newnode	= new Node(newnum);
-                  insert(root, root, newnode);
+		  loadFileParallel(root, input, pool);
+		  print(root, 0);
 		}
-	      print(root, 0); // print out the tree after insertion
-	      inFile.close();
 	    }
 	  else
 	    {
@@ -114,9 +355,17 @@ int main()
 	  int searchkey = 0; // this is the number we're trying to remove
 	  cin >> searchkey;
 	  cin.ignore(max, '\n');
+#ifdef RBTREE_MULTISET
+	  if (counting && search(root, searchkey)) // take away one copy
+	    {
+	      int copies = removeCounted(root, searchkey, pool);
+	      cout << searchkey << " is in the tree " << copies << (copies == 1 ? " time." : " times.") << endl;
+	    }
+	  else
+#endif
 	  if (search(root, searchkey)) // if the node exists
 	    {
-	      remove(root, root, root, searchkey);
+	      remove(root, root, searchkey, pool);
 	    }
 	  else
 	    {
@@ -124,6 +373,196 @@ int main()
 	    }
 	  print(root, 0);
         }
+      // shows the two halves of a split, then joins them back together
+      else if (strcmp(input, "split") == 0)
+	{
+	  cout << "Which value should the tree be split at?" << endl;
+	  int key = 0;
+	  cin >> key;
+	  cin.ignore(max, '\n');
+	  Node* smaller = NULL;
+	  Node* bigger = NULL;
+	  Node* found = NULL;
+	  split(root, key, smaller, bigger, found);
+	  cout << "Values smaller than " << key << ":" << endl;
+	  print(smaller, 0);
+	  cout << "Values bigger than " << key << ":" << endl;
+	  print(bigger, 0);
+	  if (found != NULL)
+	    {
+	      root = join(smaller, found, bigger);
+	    }
+	  else
+	    {
+	      root = joinTwo(smaller, bigger);
+	    }
+	  cout << "Joined back together:" << endl;
+	  print(root, 0);
+	}
+      else if (strcmp(input, "intervals") == 0) // stabbing and overlap queries
+	{
+	  cout << "How many intervals should the test tree have?" << endl;
+	  int count = 0;
+	  cin >> count;
+	  cin.ignore(max, '\n');
+	  benchmarkIntervals(count);
+	}
+#ifdef RBTREE_MULTISET
+      else if (strcmp(input, "multiset") == 0) // count repeats or reject them
+	{
+	  counting = !counting;
+	  if (counting)
+	    {
+	      cout << "Repeated values will now be counted." << endl;
+	    }
+	  else
+	    {
+	      cout << "Repeated values will now be rejected again." << endl;
+	    }
+	}
+#endif
+      else if (strcmp(input, "freeze") == 0) // cache-friendly read-only copy
+	{
+	  benchmarkFrozen(root);
+	}
+      else if (strcmp(input, "clear") == 0) // delete every node at once
+	{
+	  pool.clear();
+	  root = NULL;
+	  cout << "The tree is now empty." << endl;
+	}
+      // lists every value from low up to (but not including) high
+      else if (strcmp(input, "range") == 0)
+	{
+	  cout << "What is the lowest value in the range?" << endl;
+	  int low = 0;
+	  cin >> low;
+	  cout << "What value should the range stop before?" << endl;
+	  int high = 0;
+	  cin >> high;
+	  cin.ignore(max, '\n');
+	  int found = rangeVisit(root, low, high, printVisited, NULL);
+	  cout << endl << found << " values found." << endl;
+	}
+#ifndef NO_ORDER_STATISTICS
+      // counts the values smaller than a number
+      else if (strcmp(input, "rank") == 0)
+	{
+	  cout << "Which number do you want the rank of?" << endl;
+	  int searchkey = 0;
+	  cin >> searchkey;
+	  cin.ignore(max, '\n');
+	  cout << rankOf(root, searchkey) << " values in the tree are smaller than "
+	       << searchkey << "." << endl;
+	}
+      // finds the k-th smallest value (k = 1 is the smallest)
+      else if (strcmp(input, "select") == 0)
+	{
+	  cout << "Which position do you want (1 = smallest)?" << endl;
+	  int k = 0;
+	  cin >> k;
+	  cin.ignore(max, '\n');
+	  Node* found = selectKth(root, k - 1);
+	  if (found)
+	    {
+	      cout << "Value number " << k << " is " << found->getValue() << "." << endl;
+	    }
+	  else
+	    {
+	      cout << "The tree does not have that many values." << endl;
+	    }
+	}
+#endif
+      else if (strcmp(input, "benchmark") == 0) // time the tree on test data
+	{
+	  cout << "How many keys should the test trees have?" << endl;
+	  int count = 0;
+	  cin >> count;
+	  cin.ignore(max, '\n');
+	  benchmarkTree(count);
+	}
+      else if (strcmp(input, "sequential") == 0) // worst case for fix-ups
+	{
+	  cout << "How many keys should be inserted?" << endl;
+	  int count = 0;
+	  cin >> count;
+	  cin.ignore(max, '\n');
+	  benchmarkSequential(count);
+	}
+      else if (strcmp(input, "readers") == 0) // concurrent lookups and writes
+	{
+	  cout << "How many reader threads should run?" << endl;
+	  int threads = 0;
+	  cin >> threads;
+	  cin.ignore(max, '\n');
+	  cout << "How many keys should the test tree have?" << endl;
+	  int count = 0;
+	  cin >> count;
+	  cin.ignore(max, '\n');
+	  benchmarkReaders(threads, count);
+	}
+      else if (strcmp(input, "shards") == 0) // sharded tree thread scaling
+	{
+	  cout << "How many keys should be inserted?" << endl;
+	  int count = 0;
+	  cin >> count;
+	  cin.ignore(max, '\n');
+	  cout << "What is the most threads to try?" << endl;
+	  int threads = 0;
+	  cin >> threads;
+	  cin.ignore(max, '\n');
+	  benchmarkShards(count, threads);
+	}
+      else if (strcmp(input, "versions") == 0) // persistent snapshots
+	{
+	  cout << "How many keys should the test tree have?" << endl;
+	  int count = 0;
+	  cin >> count;
+	  cin.ignore(max, '\n');
+	  benchmarkVersions(count);
+	}
+      else if (strcmp(input, "save") == 0) // write a binary snapshot
+	{
+	  cout << "What is the name of the file to save to?" << endl;
+	  cin.getline(input, max);
+	  if (!saveSnapshot(root, input))
+	    {
+	      cout << "The tree could not be saved." << endl;
+	    }
+	}
+      else if (strcmp(input, "load") == 0) // replace the tree with a snapshot
+	{
+	  cout << "What is the name of the saved tree?" << endl;
+	  cin.getline(input, max);
+	  // load into a pool of its own so a bad file leaves the tree alone
+	  Node* loaded = NULL;
+	  NodePool loadedPool;
+	  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	  if (!loadSnapshot(loaded, input, loadedPool))
+	    {
+	      cout << "The file could not be loaded. The tree was not changed."
+		   << endl;
+	    }
+	  else
+	    {
+	      chrono::steady_clock::time_point end = chrono::steady_clock::now();
+	      pool.clear(); // the snapshot replaces whatever was in the tree
+	      pool.adopt(loadedPool);
+	      root = loaded;
+	      cout << "Loaded in "
+		   << chrono::duration<double, milli>(end - start).count()
+		   << " ms" << endl;
+	      print(root, 0);
+	    }
+	}
+#ifdef RBTREE_TRACE
+      // shows the rebalancing counters and the most recent events
+      else if (strcmp(input, "trace") == 0)
+	{
+	  tracePrint();
+	  traceReset();
+	}
+#endif
       else if (strcmp(input, "print") == 0) // visual display of tree
         {
 	  print(root, 0);
@@ -137,7 +576,12 @@ int main()
 	  cin >> searchkey;
 	  cin.ignore(max, '\n');
 	  Node* found = search(root, searchkey);
-	  if (found) // if the node exists
+	  if (found && found->getCount() > 1) // a repeated value
+	    {
+	      cout << "This value exists in the tree " << found->getCount()
+		   << " times." << endl;
+	    }
+	  else if (found) // if the node exists
 	    {
 	      cout << "This value exists in the tree." << endl;
 	    }
@@ -151,859 +595,923 @@ int main()
 }
 
 /**
- * This function takes in a new node (created above in main) which contains
- * a new value. It compares the new node's value to the root of the binary
- * search tree. If the new value is greater, it goes down to the right child,
- * and if it is lesser, it goes down the left. This process is repeated
- * with each node until the new value reaches a left and establishes
- * its position there. It then readjusts the tree based on the red black tree
- * cases.
+ * This function reads every integer in a file into an array on the heap,
+ * using a FileScanner to do the parsing. The array doubles in size
+ * whenever it fills up. The caller is responsible for deleting the array.
  *
- * @param root | the root of the btree in question
- * &param current | the current node in the btree we're evaluating
- * @param newnode | the node we want to put in
+ * @param filename | the name of the file to read
+ * @param count | set to the number of integers that were read
  */
-void insert(Node* &root, Node* current, Node* newnode)
+int* readFile(char* filename, int &count)
 {
-  if (root == NULL) // empty tree
+  int capacity = 16;
+  int* values = new int[capacity];
+  count = 0;
+  FileScanner scanner;
+  if (!scanner.open(filename))
     {
-      root = newnode;
-      // since root was inserted as red, we must fix the violations
-      fixInsert(root, newnode);
-      return;
+      return values; // no file means no values
     }
-  
-  // the new node is smaller than the parent; add to left branch
-  else if (newnode->getValue() < current->getValue())
+  while (true)
     {
-      if (current->getLeft() == NULL) // reached a leaf
+      if (count == capacity) // out of room; double the array
 	{
-	  current->setLeft(newnode);
-	  current->getLeft()->setParent(current); // establish the parent
-	  fixInsert(root, newnode);
+	  int* bigger = new int[capacity * 2];
+	  for (int i = 0; i < count; i++)
+	    {
+	      bigger[i] = values[i];
+	    }
+	  delete[] values;
+	  values = bigger;
+	  capacity *= 2;
 	}
-      else // keep moving down the tree
+      // parse straight into the free part of the array
+      int found = scanner.next(values + count, capacity - count);
+      if (found == 0) // the end of the file
 	{
-	  insert(root, current->getLeft(), newnode);
+	  break;
 	}
+      count += found;
     }
+  scanner.close();
+  return values;
+}
 
-  // the new node is larger than the parent; add to right branch
-  else if (newnode->getValue() > current->getValue())
+/**
+ * This function loads a file into the (empty) tree with loadUnsorted,
+ * using every core, and times it against the "read" command's loop (parse
+ * a batch, insertBatch it) on a throwaway tree. Both times include
+ * parsing the file.
+ */
+void loadFileParallel(Node* &root, char* filename, NodePool &pool)
+{
+  int threads = thread::hardware_concurrency();
+  if (threads < 1)
     {
-      if (current->getRight() == NULL) // reached a leaf
-	{
-	  current->setRight(newnode);
-	  current->getRight()->setParent(current); // establish the parent
-	  fixInsert(root, newnode);
-	}
-      else // keep moving down the tree
+      threads = 1;
+    }
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  int count = 0;
+  int* values = readFile(filename, count);
+  chrono::steady_clock::time_point parsed = chrono::steady_clock::now();
+  int total = count;
+  int skipped = loadUnsorted(root, values, count, threads, pool);
+  chrono::steady_clock::time_point end = chrono::steady_clock::now();
+  delete[] values;
+
+  // the same file through the read loop
+  chrono::steady_clock::time_point readStart = chrono::steady_clock::now();
+  FileScanner scanner;
+  Node* compare = NULL;
+  NodePool comparePool;
+  if (scanner.open(filename))
+    {
+      int batchSize = 65536;
+      int* batch = new int[batchSize];
+      int batchCount = 0;
+      while ((batchCount = scanner.next(batch, batchSize)) > 0)
 	{
-	  insert(root, current->getRight(), newnode);
+	  insertBatch(compare, batch, batchCount, comparePool);
 	}
+      delete[] batch;
+      scanner.close();
     }
+  chrono::steady_clock::time_point readEnd = chrono::steady_clock::now();
+  comparePool.clear();
 
-  // we cannot have two nodes of the same value
-  else if (newnode->getValue() == current->getValue())
+  if (skipped > 0)
     {
-      cout << "Two nodes of the same value cannot be added." << endl;
-      cout << "Therefore the node " << newnode->getValue() << " cannot be added more than once." << endl;
+      cout << skipped << " repeated values were skipped." << endl;
     }
+  cout << "Parallel load of " << total << " values with " << threads
+       << " threads: " << chrono::duration<double, milli>(end - start).count()
+       << " ms (" << chrono::duration<double, milli>(parsed - start).count()
+       << " ms of it parsing)" << endl;
+  cout << "Read loop: "
+       << chrono::duration<double, milli>(readEnd - readStart).count()
+       << " ms" << endl;
 }
 
 /**
- * This function is only called inside the insert function. This is because
- * a new node in the red black tree is automatically inserted as a red node
- * in a standard binary search tree. Doing this may violate properties of
- * a red-black tree, so this separate function is designed specifically to
- * fix the violations on a case-by case basis:
- * 
- * Case 1: if the new node is the root, change its color to black.
- * Case 2: the new node's parent is black. No violations.
- * Case 3: Both the new node's parent, p and uncle, u are RED. Change p and u
- * to BLACK, change grandparent g to RED, and recursively call fixInsert again.
- * Case 4: p is RED, u is BLACK or NULL, and new node is the inner grandchild.
- * Case 5: p is RED, u is BLACK or NULL, and new node is the outer grandchild.
+ * This function times insert() and search() on two throwaway trees: one
+ * built from the keys 0, 1, 2, ... in order and one built from the same
+ * keys in a random order. Every key is then looked up once (in a random
+ * order), first with search() and then with searchBatch(). The inserts
+ * and lookups per second are printed for each tree.
+ * The keys are then also inserted with insertTopDown, and both trees are
+ * emptied (remove() on one, removeTopDown on the other) to compare them.
+ * The user's tree is not touched.
+ *
+ * @param count | the number of keys in each test tree
  */
-void fixInsert(Node* &root, Node* newnode)
+void benchmarkTree(int count)
 {
-  // CASE 1: new node is the root. Just set it to black
-  if (newnode == root) // case 1
+  if (count <= 0)
     {
-      root->setColor('b');
+      cout << "The test trees need at least one key." << endl;
       return;
     }
 
-  // CASE 2: newnode's parent is black
-  else if (newnode->getParent()->getColor() == 'b') // case 2
+  // the keys in order, and the same keys shuffled
+  int* sequential = new int[count];
+  int* shuffled = new int[count];
+  srand(1); // the same shuffle every run so results can be compared
+  for (int i = 0; i < count; i++)
+    {
+      sequential[i] = i;
+      shuffled[i] = i;
+    }
+  for (int i = count - 1; i > 0; i--)
     {
-      // no violations
+      int j = rand() % (i + 1);
+      int temp = shuffled[i];
+      shuffled[i] = shuffled[j];
+      shuffled[j] = temp;
     }
 
-  // CASE 3: Parent and the uncle are RED
-  else if (newnode->getParent()->getColor() == 'r' &&
-	   getUncle(newnode) && getUncle(newnode)->getColor() == 'r') // case 3
+  for (int round = 0; round < 2; round++)
     {
-      Node* grandparent = NULL;
-      if (newnode->getParent()->getParent())
+      int* keys = sequential;
+      if (round == 1)
 	{
-	  grandparent = newnode->getParent()->getParent();
+	  keys = shuffled;
 	}
-      Node* uncle = getUncle(newnode);
 
-      // set the parent node to black to fix the red-black property violation
-      newnode->getParent()->setColor('b');
-      if (uncle) // if uncle exists
+      Node* testRoot = NULL;
+      NodePool testPool;
+      chrono::steady_clock::time_point insertStart = chrono::steady_clock::now();
+      for (int i = 0; i < count; i++)
 	{
-	  uncle->setColor('b');
+	  insert(testRoot, testRoot, testPool.getNode(keys[i]));
 	}
-      if (grandparent) // if grandparent exists
+      chrono::steady_clock::time_point insertEnd = chrono::steady_clock::now();
+      double insertSeconds = chrono::duration<double>(insertEnd - insertStart).count();
+
+      // look every key up in the shuffled order
+      int found = 0;
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      for (int i = 0; i < count; i++)
 	{
-	  grandparent->setColor('r');
+	  if (search(testRoot, shuffled[i]))
+	    {
+	      found++;
+	    }
 	}
-      fixInsert(root, grandparent); // fix any new violations
-    }
+      chrono::steady_clock::time_point end = chrono::steady_clock::now();
+      double seconds = chrono::duration<double>(end - start).count();
+
+      // the same lookups, a batch of 256 keys at a time
+      Node** results = new Node*[256];
+      int batchFound = 0;
+      start = chrono::steady_clock::now();
+      for (int i = 0; i < count; i += 256)
+	{
+	  batchFound += searchBatch(testRoot, &shuffled[i],
+				    min(256, count - i), results);
+	}
+      end = chrono::steady_clock::now();
+      double batchSeconds = chrono::duration<double>(end - start).count();
+      delete[] results;
 
-  // CASE 4: Uncle is black, and newnode is the inner grandchild (triangle)
-  // childstatus 1 is left child, childstatus 2 is right child
-  // CASE 5: Uncle is black, and newnode is the outer grandchild (line)
-  else if (newnode->getParent()->getColor() == 'r' &&
-	   ((getUncle(newnode) && getUncle(newnode)->getColor() == 'b') ||
-	    getUncle(newnode) == NULL)) // null children are black
-    {
-      Node* parent = newnode->getParent();
-      Node* grandparent = newnode->getParent()->getParent();
-      
-      // CASE 4
-      // right inner grandchild
-      if (childStatus(newnode) == 2 &&
-	  childStatus(parent) == 1)
+      if (round == 0)
+	{
+	  cout << "Sequential keys: ";
+	}
+      else
+	{
+	  cout << "Random keys: ";
+	}
+      cout << count << " inserts in " << insertSeconds * 1000 << " ms (";
+      if (insertSeconds > 0)
+	{
+	  cout << (long long)(count / insertSeconds);
+	}
+      else
 	{
-	  // tree rotation through the node's parent in the OPPOSITE direction
-	  leftRotation(parent, root);
-	  fixInsert(root, parent); // call case 5 on the parent node
+	  cout << "too fast to measure";
 	}
-      // left inner grandchild
-      else if (childStatus(newnode) == 1 &&
-             childStatus(parent) == 2)
+      cout << " inserts/sec), ";
+      cout << found << " lookups in " << seconds * 1000 << " ms (";
+      if (seconds > 0)
 	{
-	  // tree rotation in the opposite direction
-	  rightRotation(parent, root);
-	  fixInsert(root, parent);
+	  cout << (long long)(count / seconds);
 	}
+      else
+	{
+	  cout << "too fast to measure";
+	}
+      cout << " lookups/sec)" << endl;
+      cout << "  searchBatch: " << batchFound << " lookups in "
+	   << batchSeconds * 1000 << " ms (";
+      if (batchSeconds > 0)
+	{
+	  cout << (long long)(count / batchSeconds);
+	}
+      else
+	{
+	  cout << "too fast to measure";
+	}
+      cout << " lookups/sec)" << endl;
 
-      // CASE 5
-      // left outer grandchild
-      else if (childStatus(newnode) == 1 &&
-	  childStatus(parent) == 1)
+      // the same keys with the top-down insert, then both kinds of remove
+      Node* topDownRoot = NULL;
+      NodePool topDownPool;
+      start = chrono::steady_clock::now();
+      for (int i = 0; i < count; i++)
 	{
-	  // tree rotation through the grandparent
-	  if (grandparent) // if grandparent is not null
-	    {
-	      rightRotation(grandparent, root);
-	      swapColor(parent, grandparent);
-	    }
+	  insertTopDown(topDownRoot, topDownPool.getNode(keys[i]));
 	}
-      // right outer grandchild
-      else if (childStatus(newnode) == 2 &&
-	       childStatus(parent) == 2)
+      end = chrono::steady_clock::now();
+      double topDownInsert = chrono::duration<double>(end - start).count();
+      start = chrono::steady_clock::now();
+      for (int i = 0; i < count; i++)
 	{
-	  if (grandparent)
-	    {
-	      leftRotation(grandparent, root);
-	      swapColor(parent, grandparent);
-	    }
+	  remove(testRoot, testRoot, shuffled[i], testPool);
 	}
+      end = chrono::steady_clock::now();
+      double bottomUpRemove = chrono::duration<double>(end - start).count();
+      start = chrono::steady_clock::now();
+      for (int i = 0; i < count; i++)
+	{
+	  removeTopDown(topDownRoot, shuffled[i], topDownPool);
+	}
+      end = chrono::steady_clock::now();
+      double topDownRemove = chrono::duration<double>(end - start).count();
+      cout << "  top-down insert " << topDownInsert * 1000
+	   << " ms, remove() " << bottomUpRemove * 1000
+	   << " ms, top-down remove " << topDownRemove * 1000 << " ms" << endl;
     }
-  else
-    {
-      cout << "Something is wrong." << endl;
-    }
+
+  delete[] sequential;
+  delete[] shuffled;
 }
 
 /**
- * This function indicates whether the current node is a right or left child
+ * This function inserts the keys 0, 1, 2, ... (which makes the fix-up do
+ * the most work) with insert(), insertWithPath() and insertTopDown(). For
+ * each one it prints the instructions per insert (if the hardware
+ * counters can be read here) and how long single inserts take: the
+ * average, the median (p50), the 99th percentile (p99) and the slowest.
+ * The instructions are counted on a run without the per-insert timing,
+ * so the clock calls don't get counted.
  */
-int childStatus(Node* node)
+void benchmarkSequential(int count)
 {
-  if (node) // if the node is not null
+  if (count <= 0)
     {
-      if (node->getParent()->getLeft() != NULL &&
-	  node->getParent()->getLeft() == node)
+      cout << "There needs to be at least one key." << endl;
+      return;
+    }
+  InstructionCounter counter;
+  long long* latencies = new long long[count];
+  const char* names[3] = {"insert()", "insertWithPath()", "insertTopDown()"};
+
+  for (int method = 0; method < 3; method++)
+    {
+      // count instructions
+      long long instructions = -1;
+      {
+	Node* testRoot = NULL;
+	NodePool testPool;
+	// get every slab out of the way: take all count nodes first (giving
+	// one back right away would just hand out the same node again), then
+	// put them on the free list for the inserts to reuse
+	vector<Node*> warm(count);
+	for (int i = 0; i < count; i++)
+	  {
+	    warm[i] = testPool.getNode(0);
+	  }
+	for (int i = 0; i < count; i++)
+	  {
+	    testPool.returnNode(warm[i]);
+	  }
+	counter.start();
+	for (int i = 0; i < count; i++)
+	  {
+	    Node* newnode = testPool.getNode(i);
+	    if (method == 0)
+	      {
+		insert(testRoot, testRoot, newnode);
+	      }
+	    else if (method == 1)
+	      {
+		insertWithPath(testRoot, newnode);
+	      }
+	    else
+	      {
+		insertTopDown(testRoot, newnode);
+	      }
+	  }
+	instructions = counter.stop();
+      }
+
+      // time each insert
+      Node* testRoot = NULL;
+      NodePool testPool;
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      for (int i = 0; i < count; i++)
+	{
+	  Node* newnode = testPool.getNode(i);
+	  chrono::steady_clock::time_point before = chrono::steady_clock::now();
+	  if (method == 0)
+	    {
+	      insert(testRoot, testRoot, newnode);
+	    }
+	  else if (method == 1)
+	    {
+	      insertWithPath(testRoot, newnode);
+	    }
+	  else
+	    {
+	      insertTopDown(testRoot, newnode);
+	    }
+	  chrono::steady_clock::time_point after = chrono::steady_clock::now();
+	  latencies[i] = chrono::duration_cast<chrono::nanoseconds>(after - before).count();
+	}
+      chrono::steady_clock::time_point end = chrono::steady_clock::now();
+      double total = chrono::duration<double, nano>(end - start).count();
+      sort(latencies, latencies + count);
+
+      cout << names[method] << ": " << total / count << " ns/insert (p50 "
+	   << latencies[count / 2] << " ns, p99 "
+	   << latencies[(int)((long long)count * 99 / 100)] << " ns, max "
+	   << latencies[count - 1] << " ns), ";
+      if (instructions >= 0)
 	{
-	  // the current node is a left child
-	  return 1; // 1 = left
+	  cout << (double)instructions / count << " instructions/insert";
 	}
-      else if (node->getParent()->getRight() != NULL &&
-	       node->getParent()->getRight() == node)
+      else
 	{
-	  // the current node is a right child
-	  return 2; // 2 = right child
+	  cout << "instruction counts not available here";
 	}
+      cout << endl;
     }
-  return 0; // if we have some other situation going on
+  delete[] latencies;
 }
 
 /**
- * This function will return the node that is the current node's uncle, or 
- * the sibling to the parent node
+ * This function runs reader threads against a ConcurrentTree for about a
+ * second while this thread keeps inserting and removing values. The tree
+ * holds the even numbers 0, 2, 4, ... which are never removed, and the
+ * writer only touches odd numbers, so every lookup of an even number has
+ * to succeed. Prints the lookup and write rates, how many reads had to be
+ * retried, and how many wrong answers the readers got (which should be 0).
+ *
+ * @param readerThreads | how many threads do lookups
+ * @param count | how many even numbers are in the tree
  */
-
-Node* getUncle(Node* node)
+void benchmarkReaders(int readerThreads, int count)
 {
-  if (childStatus(node->getParent()) == 1) // parent is the left child
-    {
-      // returns the RIGHT child of the grandparent
-      return node->getParent()->getParent()->getRight();
-    }
-  else if (childStatus(node->getParent()) == 2) // parent is the right child
-  {
-    return node->getParent()->getParent()->getLeft(); // parent is left child
-  }
-  else
+  if (readerThreads <= 0 || count <= 0)
     {
-      return NULL;
+      cout << "There needs to be at least one reader and one key." << endl;
+      return;
     }
-}
 
-Node* getSibling(Node* node)
-{
-  if (childStatus(node) == 1) // node is a left child
+  ConcurrentTree tree(readerThreads);
+  for (int i = 0; i < count; i++)
     {
-      if (node->getParent()->getRight())
-	{
-	  return node->getParent()->getRight();
-	}
+      tree.insert(i * 2);
     }
-  else if (childStatus(node) == 2) // node is a right child
+
+  atomic<bool> stop(false);
+  long* lookups = new long[readerThreads];
+  long* wrong = new long[readerThreads];
+  thread* threads = new thread[readerThreads];
+  for (int i = 0; i < readerThreads; i++)
     {
-      if (node->getParent()->getLeft())
-	{
-	  return node->getParent()->getLeft();
-	}
+      lookups[i] = 0;
+      wrong[i] = 0;
+      threads[i] = thread(readerLoop, &tree, count, &stop, &lookups[i],
+			  &wrong[i]);
     }
-  return NULL;
-}
 
-/**
- * This function performs a right rotation around a given node "current."
- */
-void rightRotation(Node* current, Node* &root)
-{
-  // if the right subtree of the left child exists
-  if (current->getLeft())
+  // keep writing odd numbers for about a second
+  srand(2);
+  long writes = 0;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  chrono::steady_clock::time_point end = start;
+  while (chrono::duration<double>(end - start).count() < 1.0)
     {
-      Node* rightSubtree = NULL;
-      Node* rotated = current->getLeft(); // this will take current's place
-      if (rotated->getRight())
-	{
-	  rightSubtree = rotated->getRight();
-	}
-	  if (current->getParent()) // if the rotated node is NOT the root
+      for (int i = 0; i < 100; i++)
 	{
-	  // set left child's parent as the grandparent
-	  rotated->setParent(current->getParent());
-
-	  // depending on whether current itself was a left or right child
-	  // current's left child will take the place of current
-	  if (childStatus(current) == 1) // left child
+	  int key = (rand() % count) * 2 + 1;
+	  if (writes % 2 == 0)
 	    {
-	      //cout << "current is a left child" << endl;
-	      current->getParent()->setLeft(rotated);
+	      tree.insert(key);
 	    }
-	  else if (childStatus(current) == 2) // right child
+	  else
 	    {
-	      //cout << "current is a right child" << endl;
-	      current->getParent()->setRight(rotated);
+	      tree.remove(key);
 	    }
+	  writes++;
 	}
-      else if (!current->getParent()) // the rotated node IS the root
-	{
-	  // in this case, there is no parent
-	  // we have to redefine the root as the rotated node
-	  //cout << "hello" << endl;
-	  root = rotated;
-	  root->setParent(NULL);
-	  cout << current->getValue() << endl;
-	}
-
-      current->setParent(rotated); // current becomes the right subtree
-      rotated->setRight(current);
-
-      // the old right subtree becomes current's left subtree
-      current->setLeft(rightSubtree);
-      if (rightSubtree) // make sure right subtree isn't null                              
-            {
-              rightSubtree->setParent(current);
-            }
+      end = chrono::steady_clock::now();
     }
+  stop.store(true);
+  long totalLookups = 0;
+  long totalWrong = 0;
+  for (int i = 0; i < readerThreads; i++)
+    {
+      threads[i].join();
+      totalLookups += lookups[i];
+      totalWrong += wrong[i];
+    }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  cout << readerThreads << " readers: " << (long long)(totalLookups / seconds)
+       << " lookups/sec, writer: " << (long long)(writes / seconds)
+       << " writes/sec" << endl;
+  cout << tree.getRetries() << " reads were retried, " << totalWrong
+       << " wrong answers, " << tree.getHeldCount()
+       << " removed nodes still held" << endl;
+
+  delete[] threads;
+  delete[] lookups;
+  delete[] wrong;
 }
 
 /**
- * This function performs a left rotation around a given node "current."
+ * This function is what each reader thread in benchmarkReaders runs. It
+ * looks up even numbers (which are always in the tree) until told to
+ * stop, and every so often scans a short range, which has to hold exactly
+ * the even numbers in it.
  */
-void leftRotation(Node* current, Node* &root)
+void readerLoop(ConcurrentTree* tree, int count, atomic<bool>* stop,
+		long* lookups, long* wrong)
 {
-  // if the right subtree of the left child exists
-  if (current->getRight())
+  int reader = tree->addReader();
+  if (reader < 0) // the tree has no reader numbers left for this thread
     {
-      Node* rotated = current->getRight(); // this will take current's place
-      Node* leftSubtree = NULL;
-      if (rotated->getLeft())
+      cerr << "No reader number was left for this thread." << endl;
+      *lookups = 0;
+      *wrong = 0;
+      return;
+    }
+  unsigned int seed = reader + 1; // each thread gets its own numbers
+  int values[32];
+  long done = 0;
+  long bad = 0;
+  while (!stop->load(memory_order_relaxed))
+    {
+      seed = seed * 1103515245 + 12345;
+      int key = (int)((seed >> 8) % count) * 2;
+      if (done % 64 == 63) // range scan of the 16 numbers from key
 	{
-	  leftSubtree = rotated->getLeft();
-	}
-	  if (current->getParent() != NULL) // if the rotated node is NOT the root
+	  int found = tree->rangeScan(reader, key, key + 16, values, 32);
+	  int evens = 0;
+	  for (int i = 0; i < found; i++)
 	    {
-	      // set left child's parent as the grandparent
-	      rotated->setParent(current->getParent());
-
-	      // depending on whether current itself was a left or right child
-	      // current's left child will take the place of current
-	      if (childStatus(current) == 1) // left child
-		{
-		  current->getParent()->setLeft(rotated);
-		}
-	      else if (childStatus(current) == 2) // right child
+	      if (values[i] % 2 == 0)
 		{
-		  current->getParent()->setRight(rotated);
+		  evens++;
 		}
 	    }
-	  else if (current == root) // rotated node IS the root
+	  int expected = count - key / 2;
+	  if (expected > 8)
 	    {
-	      root = rotated;
-	      root->setParent(NULL);
-	      cout << rotated->getValue() << endl;
+	      expected = 8;
 	    }
-
-	  current->setParent(rotated); // current becomes the right subtree
-	  rotated->setLeft(current);
-	  
-	  // the old right subtree becomes current's left subtree
-	  current->setRight(leftSubtree);
-	  if (leftSubtree) // make sure left subtree isn't null
+	  if (evens != expected)
 	    {
-	      leftSubtree->setParent(current);
+	      bad++;
 	    }
+	}
+      else if (!tree->search(reader, key))
+	{
+	  bad++;
+	}
+      done++;
     }
+  *lookups = done;
+  *wrong = bad;
 }
 
 /**
- * This function swaps the colors of two nodes, a and b
- */
-void swapColor(Node* a, Node* b)
-{
-  char aColor = a->getColor();
-  a->setColor(b->getColor());
-  b->setColor(aColor);
-}
-
-/**
- * This function, given a searchkey, removes the requested node from the 
- * binary tree.
- * If the node is question has no children, the node is simply deleted.
- * If the node has one child, the child is adopted by the grandparent.
- * If the node has two children, we must find the next largest node.
- * This means we go to the right child, then as left as possible. The
- * left descendant replaces the original node. The left descendant's child,
- * who should be a right child, is then adopted by its grandparent. 
+ * This function times a ShardedTree with 1, 2, 4, ... up to maxThreads
+ * threads (and as many shards as threads). For each thread count it
+ * inserts the same random keys twice: once with one parallel insertBatch,
+ * and once with every thread calling insert() on its own share of the
+ * keys. It also times walking all the shards in order, and checks that
+ * the walk really comes out sorted.
+ *
+ * @param count | how many random keys to insert
+ * @param maxThreads | the most threads to try
  */
-
-void remove(Node* &root, Node* current, Node* parent, int searchkey)
+void benchmarkShards(int count, int maxThreads)
 {
-  // during a deletion, "replacer" replaces "deleted"
-  Node* deleted = NULL;
-  Node* replacer = NULL; // this node replaces current's spot in the tree
-  Node* temp = NULL; // this stores current before it gets deleted
-  
-  // this is the parent of the node that got replaced
-  Node* replacedParent = NULL;
-  
-  // This returns if the searchkey isn't found
-  // This shouldn't happen because we have built in a searchkey check
-  // up in main
-  if (current == NULL)
+  if (count <= 0 || maxThreads <= 0)
     {
+      cout << "There needs to be at least one key and one thread." << endl;
       return;
     }
-  
-  // we have found the node to remove
-  if (searchkey == current->getValue())
+
+  int* keys = new int[count];
+  int* batch = new int[count]; // insertBatch sorts what it's given
+  srand(3);
+  for (int i = 0; i < count; i++)
     {
+      keys[i] = rand();
+    }
 
-      if (current->getParent())
+  int threads = 1;
+  while (true)
+    {
+      // one parallel batch
+      ShardedTree batchTree(threads);
+      for (int i = 0; i < count; i++)
 	{
-	  replacedParent = current->getParent();
+	  batch[i] = keys[i];
 	}
-      // this node has no children; we can just delete it
-      if (current->getLeft() == NULL &&
-	  current->getRight() == NULL)
-      {
-	cout << "node has no children" << endl;
-	fixRemove(root, replacer, current);
-	if (current == root) // only the root is in the tree
-	  {
-	    root = NULL; // the tree is now empty
-	  }
-	if (parent->getLeft() == current) // current is a left child
-	  {
-	    parent->setLeft(NULL);
-	  }
-	else if (parent->getRight() == current) // current is a right child
-	  {
-	    parent->setRight(NULL);
-	  }
-	deleted = current;
-      	temp = current;
-	
-      }
-
-      // if the node has one child
-      else if (current->getLeft() == NULL || current->getRight() == NULL)
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      batchTree.insertBatch(batch, count, threads);
+      chrono::steady_clock::time_point end = chrono::steady_clock::now();
+      double batchSeconds = chrono::duration<double>(end - start).count();
+
+      // each thread inserting its own share one key at a time
+      ShardedTree singleTree(threads);
+      thread* workers = new thread[threads];
+      start = chrono::steady_clock::now();
+      for (int t = 0; t < threads; t++)
 	{
-	  cout << "node has one child" << endl;
-	  // this is the current node's non-null child
-	  // this child will be adopted by current node's parent
-	  Node* child = NULL;
-
-	  // determine which child is not null
-	  if (current->getLeft() != NULL)
-	    {
-	      child = current->getLeft();
-	    }
-	  else if (current->getRight() != NULL)
-	    {
-	      child = current->getRight();
-	    }
-
-	  fixRemove(root, child, current);
-	  // if the node to be removed is the root
-	  if (current == root)
+	  int first = (int)((long long)count * t / threads);
+	  int last = (int)((long long)count * (t + 1) / threads);
+	  workers[t] = thread(insertSlice, &singleTree, keys + first,
+			      last - first);
+	}
+      for (int t = 0; t < threads; t++)
+	{
+	  workers[t].join();
+	}
+      end = chrono::steady_clock::now();
+      double singleSeconds = chrono::duration<double>(end - start).count();
+      delete[] workers;
+
+      // walk every value in order
+      bool sorted = true;
+      int walked = 0;
+      int previous = 0;
+      start = chrono::steady_clock::now();
+      for (ShardIterator it(&batchTree); !it.atEnd(); ++it)
+	{
+	  if (walked > 0 && *it <= previous)
 	    {
-	      // we cannot just delete the root since it's by reference
-	      temp = current;
-	      root = child;
+	      sorted = false;
 	    }
-	  else // the node to be removed isn't the root
-	    {
-	      // adopt the child (if the current node is not the root)
-	      if (parent->getLeft() == current)
-		{
-		  parent->setLeft(child);
-		}
-	      else if (parent->getRight() == current)
-		{
-		  parent->setRight(child);
-		}
-	      
-	      //replacer = child;
-	      //deleted = current;
-	      temp = current;
-	    }
-
-	  cout << "the node replaced: " << replacer->getValue() << endl;
-	}
-
-      // the node has two children
-      else if (current->getLeft() != NULL && current->getRight() != NULL)
-	{
-	  cout << "node has two children" << endl;
-	  // we need to find the next largest node AND the next largest node's
-	  // parent
-	  // go to the right child, then go left as far as possible
-	  Node* nextLargest = current->getRight();
-	  Node* nextLargestParent = current;
-	  while (nextLargest->getLeft() != NULL)
-	    {
-	      nextLargestParent = nextLargest;
-	      nextLargest = nextLargest->getLeft();
-	    }
-	  
-	  // we must save the child's subtree
-	  // this is the child of the next largest node
-	  Node* nextChild = nextLargest->getRight();
-
-	  // swap the value of the next largest and the node to be deleted
-	  int currentValue = current->getValue();
-	  current->setValue(nextLargest->getValue());
-	  nextLargest->setValue(currentValue); // we will remove this node
-
-	  // call recursively bc nextLargest will only have 0 or 1 children
-	  remove(root, nextLargest, nextLargestParent, searchkey);
-	  /*
-	  // next, we must disconnect the next largest from its subtree
-	  // this is because we are moving the next largest to replace
-	  // the current node and we don't want it to have baggage
-	  nextLargest->setRight(NULL);
-
-	  // nextLargest will replace where the parent node used to be
-	  if (current == root) // if the node to be removed is the root
-	    {
-	      temp = current;
-	      root = nextLargest; // root replaced by next largest
-
-	      // connect nextLargest to the root's original subtree
-	      if (current->getLeft() != nextLargest)
-                {
-                  nextLargest->setLeft(current->getLeft());
-                }
-              if (current->getRight() != nextLargest)
-                {
-                  nextLargest->setRight(current->getRight());
-                }
-
-	      // nextLargest's original parent will adopt nextLargest's child
-              if (nextLargestParent != current)
-                {
-                  nextLargestParent->setLeft(nextChild);
-		  nextChild->setParent(nextLargestParent());
-                }
-
-	    }
-	  else // the node to be removed isn't the root
-            {
-              if (parent->getLeft() == current) // current is a left child
-                {
-                  parent->setLeft(nextLargest);
-                }
-              else if (parent->getRight() == current) // current = right child
-                {
-		  parent->setRight(nextLargest);
-                }
-	      nextLargest->setParent(parent);
-	      // the next largest has replaced the current node's position
-	      // we much attach the nextLargest to current node's subtree
-	      if (current->getLeft() != nextLargest)
-		{
-		  nextLargest->setLeft(current->getLeft());
-		}
-	      if (current->getRight() != nextLargest)
-		{
-		  nextLargest->setRight(current->getRight());
-		}
-	      
-	      // there is still an empty space between nextLargest's parent
-	      // and nextLargest's child; we must bridge that gap
-	      if (nextLargestParent != current)
-		{
-		  nextLargestParent->setLeft(nextChild);
-		}
+	  previous = *it;
+	  walked++;
+	}
+      end = chrono::steady_clock::now();
+      double walkSeconds = chrono::duration<double>(end - start).count();
+      if (walked != batchTree.getSize() || walked != singleTree.getSize())
+	{
+	  sorted = false;
+	}
 
-	      replacer = nextChild;
-	      deleted = nextLargest;
-              temp = current;
-	      }*/
+      cout << threads << " threads: batch " << (long long)(count / batchSeconds)
+	   << " keys/sec, insert() " << (long long)(count / singleSeconds)
+	   << " keys/sec, ordered walk of " << walked << " values in "
+	   << walkSeconds * 1000 << " ms";
+      if (!sorted)
+	{
+	  cout << " (NOT IN ORDER)";
 	}
+      cout << endl;
 
-      // fix violations
-      //print(root, 0);
-      //fixRemove(root, replacer, deleted);
-      delete temp;
-    }
-  else if (searchkey < current->getValue())
-    {
-      remove(root, current->getLeft(), current, searchkey);
+      if (threads == maxThreads)
+	{
+	  break;
+	}
+      threads *= 2;
+      if (threads > maxThreads)
+	{
+	  threads = maxThreads;
+	}
     }
-  else if (searchkey > current->getValue())
+
+  delete[] keys;
+  delete[] batch;
+}
+
+// inserts count keys one at a time; run by each benchmarkShards thread
+void insertSlice(ShardedTree* tree, int* keys, int count)
+{
+  for (int i = 0; i < count; i++)
     {
-      remove(root, current->getRight(), current, searchkey);
+      tree->insert(keys[i]);
     }
 }
 
 /**
- * This function fixes violations in the red black tree after removing
- * a node.
- * @param node | This is the node that replaces the removed node in the tree.
- * @param deleted | This is the node that is to be removed from the tree. 
+ * This function is handed to rangeVisit by the "range" command. It prints
+ * one value on the current line.
+ */
+void printVisited(Node* node, void*)
+{
+  cout << node->getValue() << " ";
+}
+
+/**
+ * This function freezes the tree into a FrozenTree and times the same
+ * lookups (random numbers between the smallest and largest value) and
+ * range scans (about 16 values each) on both, checking that they give
+ * the same answers.
  */
-void fixRemove(Node* &root, Node* node, Node* deleted)
+void benchmarkFrozen(Node* root)
 {
-  Node* parent = NULL;
-  char ncolor = 'b';
-  char dcolor = 'b';
-  if (deleted)
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  FrozenTree frozen;
+  frozen.freeze(root);
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  int size = frozen.getSize();
+  if (size == 0)
     {
-      dcolor = deleted->getColor();
+      cout << "There is nothing to freeze; add some values first." << endl;
+      return;
     }
-  if (node)
+  cout << "Froze " << size << " values in " << seconds * 1000 << " ms."
+       << endl;
+
+  // random keys in the range the values cover, made ahead of time
+  long long smallest = frozen.getValue(0);
+  long long span = (long long)frozen.getValue(size - 1) - smallest + 1;
+  int lookups = 1000000;
+  int* keys = new int[lookups];
+  srand(3);
+  for (int i = 0; i < lookups; i++)
     {
-      ncolor = node->getColor();
-      cout << "replacer value " << node->getValue() << endl;
+      long long offset = ((long long)rand() * RAND_MAX + rand()) % span;
+      keys[i] = (int)(smallest + offset);
     }
-  if (deleted)
+
+  int found = 0;
+  start = chrono::steady_clock::now();
+  for (int i = 0; i < lookups; i++)
     {
-      cout << "deleted value " << deleted->getValue() << endl;
+      found += (search(root, keys[i]) != NULL);
     }
-
-  // PART I: node = red, deleted = black - we have lost one black node
-  if (ncolor == 'r' && dcolor == 'b')
+  double treeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  int frozenFound = 0;
+  start = chrono::steady_clock::now();
+  for (int i = 0; i < lookups; i++)
     {
-      cout << "part i" << endl;
-      // the new node becomes black to replace the black node lost.
-      node->setColor('b');
+      frozenFound += frozen.search(keys[i]);
     }
-
-  // PART II: node = black, deleted = red
-  else if (ncolor == 'b' && dcolor == 'r')
+  double frozenSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cout << "lookups: tree " << (long long)(lookups / treeSeconds)
+       << "/sec, frozen " << (long long)(lookups / frozenSeconds)
+       << "/sec (" << treeSeconds / frozenSeconds << "x)" << endl;
+
+  // scans wide enough to hold about 16 values
+  long long width = span / size * 16 + 1;
+  int scans = lookups / 10;
+  long treeValues = 0;
+  start = chrono::steady_clock::now();
+  for (int i = 0; i < scans; i++)
+    {
+      long long high = min((long long)keys[i] + width, (long long)INT_MAX);
+      rangeVisit(root, keys[i], (int)high, countVisited, &treeValues);
+    }
+  treeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  long frozenValues = 0;
+  int values[1024];
+  start = chrono::steady_clock::now();
+  for (int i = 0; i < scans; i++)
     {
-      cout << "part ii" << endl;
-      // since deleted is the red node, the total black height of the
-      // tree doesn't change so we're good
+      long long high = min((long long)keys[i] + width, (long long)INT_MAX);
+      frozenValues += frozen.rangeScan(keys[i], (int)high, values, 1024);
     }
+  frozenSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cout << "range scans: tree " << (long long)(scans / treeSeconds)
+       << "/sec, frozen " << (long long)(scans / frozenSeconds)
+       << "/sec (" << treeSeconds / frozenSeconds << "x)" << endl;
 
-  // PART III: BOTH nodes = black; we have problems with the black height
-  else if (ncolor == 'b' && dcolor == 'b')
+  if (found != frozenFound || treeValues != frozenValues)
     {
-      cout << "part iii" << endl;
-      deleteByCase(node, deleted, root);
+      cout << "The frozen copy gave different answers!" << endl;
     }
+  delete[] keys;
+}
 
+// counts the nodes a range visits, for benchmarkFrozen
+void countVisited(Node*, void* data)
+{
+  long* count = (long*)data;
+  (*count)++;
 }
 
 /**
- * In the case during a deletion where both the deleted node and the node 
- * used to replace the deleted node are BLACK, we must account for six
- * possible cases of violations.
+ * This function fills a PersistentTree with 0 to count - 1, takes a
+ * snapshot of it, and starts a "report" thread that keeps reading the
+ * whole snapshot while this thread does count writes (each removing one
+ * of the first values or adding a new one past the end). The report has
+ * to see exactly the values from when the snapshot was taken every time.
+ * Prints the write rate, how many reports finished (and how many were
+ * wrong, which should be 0), and how many nodes the two versions share.
  */
-void deleteByCase(Node* node, Node* deleted, Node* &root)
+void benchmarkVersions(int count)
 {
-  Node* parent = NULL;
-  Node* sibling = NULL;
-  int nChildStatus = 0; // is the deleted node a right or left child?
-
-  if (node && node != root)
-    {
-      cout << "current node value: " << node->getValue() << endl;
-      cout << "the replaced node exists" << endl;
-      parent = node->getParent();
-      sibling = getSibling(node);
-      cout << "sibling: " << sibling->getValue() << endl;
-      nChildStatus = childStatus(node);
-    }
-  else // the node was completely deleted and replaced with a null pointer
-    {
-      cout << "replacer is NULL" << endl;
-      parent = deleted->getParent();
-      cout << "parent of the replacer node: " << parent->getValue() << endl;
-      
-      // the node is null; we cannot use getSibling to get the sibling
-      // this is because parent is no longer point to the node
-      /*if (parent->getLeft() == NULL) // left child is NULL
-	{
-	  sibling = parent->getRight();
-	  nChildStatus = 1;
-	}
-      else if (parent->getRight() == NULL) // right child is NULL
-	{
-	  sibling = parent->getLeft();
-	  nChildStatus = 2;
-	  }*/
-      sibling = getSibling(deleted);
-      nChildStatus = childStatus(deleted);
-      cout << "sibling: " << sibling->getValue() << " status: " << nChildStatus  << endl;
-    }
-  
-  cout << "inside delete by case" << endl;
-  // CASE 1: the newly replaced node = the new root
-  if (node == root)
-    {
-      cout << "case 1" << endl;
-      // nothing happens since the black height of the tree is balanced
+  if (count <= 0)
+    {
+      cout << "There needs to be at least one key." << endl;
       return;
     }
-  else // the new node is NOT the root
-    {
-      cout << "NOT case 1" << endl;
-      // these color shorthands will be used when we're checking cases
-      char sColor = 'b'; // sibling color
-      char pColor = parent->getColor(); // parent color;
-      char rcColor = 'b'; // sibling's right child's color
-      char lcColor = 'b'; // sibling's left child's color
 
-      if (sibling)
+  PersistentTree tree;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int i = 0; i < count; i++)
+    {
+      tree.insert(i);
+    }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cout << "filled the tree at " << (long long)(count / seconds)
+       << " inserts/sec (no snapshot held)" << endl;
+
+  PersistentNode* snapshot = tree.takeSnapshot();
+  atomic<bool> stop(false);
+  long reports = 0;
+  long wrong = 0;
+  thread reporter(reportLoop, snapshot, count, &stop, &reports, &wrong);
+
+  start = chrono::steady_clock::now();
+  for (int i = 0; i < count; i++)
+    {
+      if (i % 2 == 0)
 	{
-	  sColor = sibling->getColor();
-	  if (sibling->getRight())
-	    {
-	      rcColor = sibling->getRight()->getColor();
-	    }
-	  if (sibling->getLeft())
-	    {
-	      lcColor = sibling->getLeft()->getColor();
-	    }
+	  tree.remove(i / 2);
 	}
-
-      // CASE 2: node's sibling, s, is red, everything else is black
-      if (sColor == 'r' &&
-	  pColor == 'b' &&
-	  rcColor == 'b' &&
-	  lcColor == 'b' &&
-	  sibling)
+      else
 	{
-	  cout << "case 2" << endl;
-	  // rotate the sibling through the parent
-	  if (childStatus(sibling) == 2) // right child
-	    {
-	      leftRotation(parent, root);
-	    }
-	  else if (childStatus(sibling) == 1) // left child
-	    {
-	      rightRotation(parent, root);
-	    }
-	    swapColor(parent, sibling);
-	    
-	    // fix any new violations through a recursive call
-	    deleteByCase(node, deleted, root);
-	    return;
+	  tree.insert(count + i / 2);
 	}
+    }
+  seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  stop.store(true);
+  reporter.join();
+
+  long logical = PersistentTree::countValues(snapshot) + tree.getSize();
+  cout << "with a snapshot held: " << (long long)(count / seconds)
+       << " writes/sec, " << tree.getCopyCount() << " nodes copied" << endl;
+  cout << reports << " reports read the snapshot, " << wrong
+       << " saw the wrong values" << endl;
+  cout << "the two versions hold " << logical << " values in "
+       << tree.getNodeCount() << " nodes" << endl;
+  tree.releaseSnapshot(snapshot);
+  cout << "after releasing the snapshot: " << tree.getNodeCount()
+       << " nodes" << endl;
+}
 
-      // CASE 3: sibling = black, p, s, n, are all black
-      else if (sColor == 'b' &&
-	       pColor == 'b' &&
-	       rcColor == 'b' &&
-	       lcColor == 'b')
+/**
+ * This function is the report thread in benchmarkVersions. It reads the
+ * whole snapshot, a chunk at a time, until told to stop (and at least
+ * once), checking that it holds exactly 0 to count - 1.
+ */
+void reportLoop(PersistentNode* snapshot, int count, atomic<bool>* stop,
+		long* reports, long* wrong)
+{
+  int values[256];
+  long done = 0;
+  long bad = 0;
+  do
+    {
+      int next = 0; // the value the report expects to see next
+      bool right = true;
+      int found = 0;
+      do
 	{
-	  cout << "case 3" << endl;
-	  if (sibling)
+	  found = PersistentTree::rangeScan(snapshot, next, count + count,
+					    values, 256);
+	  for (int i = 0; i < found; i++)
 	    {
-	      // remove 1 black node on the other side of the tree
-	      sibling->setColor('r'); // color sibling red
+	      if (values[i] != next)
+		{
+		  right = false;
+		}
+	      next++;
 	    }
-	  deleteByCase(parent, deleted, root); // fix violations
-	}
-
-      // CASE 4: parent = red, sibling + sibling's children are black
-      else if (sColor == 'b' &&
-	       pColor == 'r' && // parent = red
-	       rcColor == 'b' &&
-	       lcColor == 'b' &&
-	       sibling)
-	{
-	  cout << "case 4" << endl;
-	  swapColor(parent, sibling);
-	}
-
-      // CASE 5: parent = either color, inner niece = red, else = black
-      if (nChildStatus == 2 && // node is a right child
-	       sColor == 'b' &&
-	       rcColor == 'r' && // inner niece = red
-	       lcColor == 'b' &&
-	       sibling)
-	{
-	  cout << "case 5 right node" << endl;
-	  print(root, 0);
-	  // rotate through the sibling (rotate OUTWARD)
-	  swapColor(sibling, sibling->getRight());
-	  leftRotation(sibling, root);
-	  print(root, 0);
-	  deleteByCase(node, deleted, root);
-	}
-      else if (nChildStatus == 1 && // node is a left child
-	       sColor == 'b' &&
-	       rcColor == 'b' &&
-	       lcColor == 'r' && // inner niece = red
-	       sibling)
-	{
-	  cout << "case 5 left node" << endl;
-	  swapColor(sibling, sibling->getLeft());
-	  rightRotation(sibling, root);
-	  deleteByCase(node, deleted, root);
-	}
-
-      // CASE 6: parent = either color, outer niece = red, else = black
-      else if (nChildStatus == 2 && // right child
-	       sColor == 'b' &&
-	       rcColor == 'b' &&
-	       lcColor == 'r' && // outer niece = red
-	       sibling)
-	{
-	  cout << "case 6 right node" << endl;
-	  // rotate AWAY from the sibling's child
-	  rightRotation(parent, root);
-	  swapColor(sibling, parent);
-	  sibling->getLeft()->setColor('b');
-	  print(root, 0);
 	}
-      else if (nChildStatus == 1 && // left child
-	       sColor == 'b' &&
-	       rcColor == 'r' &&
-	       lcColor == 'b' && // outer niece = red                 
-	       sibling)
+      while (found == 256 && right);
+      if (!right || next != count)
 	{
-	  cout << "case 6 left node" << endl;
-	  leftRotation(parent, root);
-	  swapColor(sibling, parent);
-	  sibling->getRight()->setColor('b');
+	  bad++;
 	}
+      done++;
     }
+  while (!stop->load(memory_order_relaxed));
+  *reports = done;
+  *wrong = bad;
 }
 
 /**
- * This function displays the binary search tree in a visual manner,
- * sideways.
- * 
- * @param current | the current node we are print out
- * @param numTabs | the number of indentations required for this node
+ * This function fills an IntervalTree with count random intervals (time
+ * ranges up to 2000 long, spread so that a point is in about one of them),
+ * then times stabbing queries and overlap queries (with windows 1000
+ * long) against checking every interval in an array. It also checks that
+ * both ways find the same number of intervals.
  */
-void print(Node* current, int numTabs)
+void benchmarkIntervals(int count)
 {
-
-  // if we get to a leaf, we want to jump out of print
-  if (current == NULL)
+  if (count <= 0)
     {
-      return; // nothing to print
+      cout << "There needs to be at least one interval." << endl;
+      return;
     }
 
-  // otherwise, we have not reached a leaf
-  numTabs += 1; // indent one more in
-  print(current->getRight(), numTabs); // recursively print right child
-  cout << endl; // line break
-  for (int i = 1; i < numTabs; i++)
+  long long spread = (long long)count * 1000; // where intervals can start
+  if (spread > INT_MAX - 2000)
     {
-      // indent the number of times as stated by numTabs
-      cout << "\t";
+      spread = INT_MAX - 2000;
     }
-  cout << current->getValue();
-  cout << " (" << current->getColor() << ") ";
-  if (current->getParent()) // if parent exists
+  int* lows = new int[count];
+  int* highs = new int[count];
+  srand(4);
+  for (int i = 0; i < count; i++)
     {
-      //cout << "p = " << current->getParent()->getValue();
-      //cout << " childstatus: " << childStatus(current);
+      lows[i] = (int)(((long long)rand() * RAND_MAX + rand()) % spread);
+      highs[i] = lows[i] + rand() % 2000;
     }
 
-  cout << "\n"; // print the current value
-  print(current->getLeft(), numTabs); // recursively print left child
-}
-
-/**
- * This function, when given a "searchkey," walks through the
- * binary tree and determines whether the searchkey is found in the tree.
- */
-Node* search(Node* current, int searchkey)
-{
-  // base case; we have not found the key
-  if (current == NULL)
+  IntervalTree tree;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int i = 0; i < count; i++)
     {
-      // we have walked through the tree without finding it
-      return NULL;
+      tree.insert(lows[i], highs[i], i); // i keeps repeated ranges apart
     }
-  
-  // the searchkey has been found
-  else if (current->getValue() == searchkey)
-    {
-      return current;
-    }
-  
-  // RECURSIVE CASES
-  // search key is less than current node; go left
-  else if (searchkey < current->getValue())
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cout << "Inserted " << tree.getSize() << " intervals in " << seconds * 1000
+       << " ms." << endl;
+
+  int queries = 1000;
+  int* points = new int[queries];
+  for (int i = 0; i < queries; i++)
     {
-      return search(current->getLeft(), searchkey);
+      points[i] = (int)(((long long)rand() * RAND_MAX + rand()) % spread);
     }
-  // search key is greater than current node; go right
-  else if (searchkey > current->getValue())
+
+  for (int kind = 0; kind < 2; kind++)
     {
-      return search(current->getRight(), searchkey);
+      int width = 0; // 0 for stabbing queries
+      if (kind == 1)
+	{
+	  width = 1000;
+	}
+      long treeFound = 0;
+      long found = 0; // intervals visited through countIntervals
+      start = chrono::steady_clock::now();
+      for (int i = 0; i < queries; i++)
+	{
+	  if (width == 0)
+	    {
+	      treeFound += tree.stab(points[i], countIntervals, &found);
+	    }
+	  else
+	    {
+	      treeFound += tree.overlap(points[i], points[i] + width,
+					countIntervals, &found);
+	    }
+	}
+      double treeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+      long scanFound = 0;
+      start = chrono::steady_clock::now();
+      for (int i = 0; i < queries; i++)
+	{
+	  int low = points[i];
+	  int high = points[i] + width;
+	  for (int j = 0; j < count; j++)
+	    {
+	      scanFound += (lows[j] <= high && highs[j] >= low);
+	    }
+	}
+      double scanSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+      if (width == 0)
+	{
+	  cout << "stabbing: ";
+	}
+      else
+	{
+	  cout << "overlap: ";
+	}
+      cout << "tree " << (long long)(queries / treeSeconds)
+	   << " queries/sec, linear scan " << (long long)(queries / scanSeconds)
+	   << " queries/sec (" << scanSeconds / treeSeconds << "x), "
+	   << treeFound << " intervals found" << endl;
+      if (treeFound != scanFound || found != treeFound)
+	{
+	  cout << "The tree and the scan found different intervals!" << endl;
+	}
     }
-  return NULL;
+
+  delete[] points;
+  delete[] lows;
+  delete[] highs;
+}
+
+// counts the intervals a query visits, for benchmarkIntervals
+void countIntervals(IntervalNode*, void* data)
+{
+  long* count = (long*)data;
+  (*count)++;
 }
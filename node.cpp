@@ -9,20 +9,26 @@ Node::Node()
 {
   // initialize all variables as null
   data = 0;
+  size = 1; // a new node is a subtree of one
+#ifdef RBTREE_MULTISET
+  count = 1;
+#endif
   left = NULL;
   right = NULL;
-  parent = NULL;
-  color = 'r'; // all nodes will be added as red nodes
+  parentColor = 0; // no parent, and all nodes will be added as red nodes
 }
 
 // regular constructor
 Node::Node(int newdata)
 {
   data = newdata;
+  size = 1;
+#ifdef RBTREE_MULTISET
+  count = 1;
+#endif
   left = NULL;
   right = NULL;
-  parent = NULL;
-  color = 'r';
+  parentColor = 0; // no parent, red
 }
 
 // destructor, which destroys anything left on the heap
@@ -30,7 +36,7 @@ Node::~Node()
 {
   left = NULL;
   right = NULL;
-  parent = NULL;
+  parentColor = 0;
 }
 
 		
@@ -52,42 +58,162 @@ int Node::getValue()
   return data;
 }
 
-// returns parent
+// returns parent (with the color bit masked off)
 Node* Node::getParent()
 {
-  return parent;
+  return (Node*)(parentColor & ~(uintptr_t)1);
 }
 
-// returns color
+// returns color, which is stored in the low bit of the parent pointer
 char Node::getColor()
 {
-  return color;
+  if (parentColor & 1)
+    {
+      return 'b';
+    }
+  return 'r';
+}
+
+// returns the next largest node, or NULL if this is the largest
+Node* Node::getNext()
+{
+  Node* current = this;
+  // the smallest node in the right subtree comes next
+  if (current->right != NULL)
+    {
+      current = current->right;
+      while (current->left != NULL)
+	{
+	  current = current->left;
+	}
+      return current;
+    }
+  // otherwise climb up until we come up from a left child
+  Node* parent = current->getParent();
+  while (parent != NULL && current == parent->right)
+    {
+      current = parent;
+      parent = parent->getParent();
+    }
+  return parent;
+}
+
+// returns the next smallest node, or NULL if this is the smallest
+Node* Node::getPrevious()
+{
+  Node* current = this;
+  // the largest node in the left subtree comes before this one
+  if (current->left != NULL)
+    {
+      current = current->left;
+      while (current->right != NULL)
+	{
+	  current = current->right;
+	}
+      return current;
+    }
+  // otherwise climb up until we come up from a right child
+  Node* parent = current->getParent();
+  while (parent != NULL && current == parent->left)
+    {
+      current = parent;
+      parent = parent->getParent();
+    }
+  return parent;
+}
+
+// returns the number of nodes in this node's subtree
+int Node::getSize()
+{
+  return size;
+}
+
+// returns how many times the value was added; without RBTREE_MULTISET
+// every value is there once
+int Node::getCount()
+{
+#ifdef RBTREE_MULTISET
+  return count;
+#else
+  return 1;
+#endif
+}
+
+/*
+ * The load functions are for readers that walk the tree while a writer may
+ * be changing it. They read the field in one piece (an atomic load), and
+ * setLeft, setRight and setValue write in one piece to match. On x86 these
+ * are ordinary moves, so single-threaded code doesn't pay anything.
+ */
+
+// returns left child, read atomically
+Node* Node::loadLeft()
+{
+  return __atomic_load_n(&left, __ATOMIC_RELAXED);
+}
+
+// returns right child, read atomically
+Node* Node::loadRight()
+{
+  return __atomic_load_n(&right, __ATOMIC_RELAXED);
+}
+
+// returns data value, read atomically
+int Node::loadValue()
+{
+  return __atomic_load_n(&data, __ATOMIC_RELAXED);
 }
 
 // set left child
 void Node::setLeft(Node* newleft)
 {
-  left = newleft;
+  __atomic_store_n(&left, newleft, __ATOMIC_RELAXED);
 }
 
 // set right child
 void Node::setRight(Node* newright)
 {
-  right = newright;
+  __atomic_store_n(&right, newright, __ATOMIC_RELAXED);
 }
 
 // set new data
 void Node::setValue(int newdata)
 {
-  data = newdata;
+  __atomic_store_n(&data, newdata, __ATOMIC_RELAXED);
+}
+
+// set the number of nodes in this node's subtree
+void Node::setSize(int newsize)
+{
+  size = newsize;
+}
+
+// set how many times the value was added; does nothing without
+// RBTREE_MULTISET, so code that moves values around can always call it
+void Node::setCount(int newcount)
+{
+#ifdef RBTREE_MULTISET
+  count = newcount;
+#else
+  (void)newcount;
+#endif
 }
 
+// set the parent, keeping the color bit as it was
 void Node::setParent(Node* newparent)
 {
-  parent = newparent;
+  parentColor = (uintptr_t)newparent | (parentColor & 1);
 }
 
+// set the color; 'b' sets the low bit and anything else clears it
 void Node::setColor(char newcolor)
 {
-  color = newcolor;
+  if (newcolor == 'b')
+    {
+      parentColor |= 1;
+    }
+  else
+    {
+      parentColor &= ~(uintptr_t)1;
+    }
 }
@@ -1,6 +1,7 @@
 #ifndef NODE_H
 #define NODE_H
 #include <iostream>
+#include <stdint.h>
 
 class Node
 {
@@ -16,6 +17,15 @@ class Node
   int getValue(); // returns data value
   Node* getParent(); // returns the parent node
   char getColor(); // returns either 'r' or 'b' for red or black
+  Node* getNext(); // returns the next largest node in the tree
+  Node* getPrevious(); // returns the next smallest node in the tree
+  int getSize(); // returns the number of nodes in this node's subtree
+  int getCount(); // returns how many times the value was added (1 unless RBTREE_MULTISET)
+
+  // getters for readers running alongside a writer (see concurrenttree.h)
+  Node* loadLeft(); // returns left child
+  Node* loadRight(); // returns right child
+  int loadValue(); // returns data value
 
   // functions (setters)
   void setLeft(Node*); // establish left child
@@ -23,14 +33,24 @@ class Node
   void setValue(int); // establish data value
   void setColor(char); // set the color of the node;
   void setParent(Node*); // set the parent, or "previous" node in the tree
+  void setSize(int); // set the number of nodes in this node's subtree
+  void setCount(int); // set how many times the value was added (needs RBTREE_MULTISET)
   
  private:
   // variables
   int data;
+  int size; // nodes in this subtree, including this one (fits in padding)
+#ifdef RBTREE_MULTISET
+  // copies of the value (see insertCounted); only built in on request, so
+  // a normal Node stays 32 bytes
+  int count;
+#endif
   Node* left;
   Node* right;
-  Node* parent;
-  char color;
+  // the parent pointer with the color packed into its lowest bit
+  // (nodes are always at least 2-byte aligned, so that bit is otherwise 0)
+  // 0 = red, 1 = black
+  uintptr_t parentColor;
   
 };
 #endif
@@ -0,0 +1,228 @@
+#include <iostream>
+#include "nodepool.h"
+
+using namespace std;
+
+// default constructor
+NodePool::NodePool()
+{
+  slabs = NULL;
+  slabCount = 0;
+  slabCapacity = 0;
+  slabSize = 4096;
+  nextFree = 0;
+  freeList = NULL;
+  held = NULL;
+  holding = false;
+  inUse = 0;
+}
+
+// constructor with a custom number of nodes per slab
+NodePool::NodePool(int newSlabSize)
+{
+  slabs = NULL;
+  slabCount = 0;
+  slabCapacity = 0;
+  slabSize = newSlabSize;
+  if (slabSize < 1)
+    {
+      slabSize = 1;
+    }
+  nextFree = 0;
+  freeList = NULL;
+  held = NULL;
+  holding = false;
+  inUse = 0;
+}
+
+// destructor, which gives every slab back to the heap
+NodePool::~NodePool()
+{
+  clear();
+}
+
+// returns a node holding the value, reusing a removed node if possible
+Node* NodePool::getNode(int newdata)
+{
+  Node* node = NULL;
+  if (freeList != NULL) // reuse a node that was removed from the tree
+    {
+      node = freeList;
+      freeList = freeList->getLeft();
+    }
+  else
+    {
+      // the newest slab is full (or there are no slabs yet)
+      if (slabCount == 0 || nextFree == slabSize)
+	{
+	  addSlab();
+	}
+      node = &slabs[slabCount - 1][nextFree];
+      nextFree++;
+    }
+
+  // reset the node so it looks just like new Node(newdata)
+  node->setValue(newdata);
+  node->setLeft(NULL);
+  node->setRight(NULL);
+  node->setParent(NULL);
+  node->setColor('r');
+  node->setSize(1);
+  node->setCount(1);
+  inUse++;
+  return node;
+}
+
+// puts a node that was removed from the tree onto the free list
+void NodePool::returnNode(Node* node)
+{
+  if (node == NULL)
+    {
+      return;
+    }
+  node->setRight(NULL);
+  node->setParent(NULL);
+  inUse--;
+  if (holding) // a reader may still be looking at it
+    {
+      node->setLeft(held);
+      held = node;
+      return;
+    }
+  node->setLeft(freeList); // the left pointer links the free list
+  freeList = node;
+}
+
+// turns holding on or off; while it is on, returnNode doesn't make nodes
+// available to getNode until they are handed back through recycle
+void NodePool::setHolding(bool newholding)
+{
+  holding = newholding;
+}
+
+// returns every node held back since the last call, linked through left
+Node* NodePool::takeHeld()
+{
+  Node* list = held;
+  held = NULL;
+  return list;
+}
+
+// puts a list of nodes from takeHeld onto the free list
+void NodePool::recycle(Node* list)
+{
+  while (list != NULL)
+    {
+      Node* next = list->getLeft();
+      list->setLeft(freeList);
+      freeList = list;
+      list = next;
+    }
+}
+
+/**
+ * This function moves every slab of another pool into this one, so nodes
+ * that were handed out by the other pool now belong to this one (and get
+ * released by this pool's clear). It is used when several threads build
+ * parts of one tree, each with its own pool. The other pool ends up empty.
+ * The other pool's newest slab may not be full; its unused nodes are
+ * never handed out, and this pool keeps filling its own newest slab.
+ */
+void NodePool::adopt(NodePool& other)
+{
+  if (other.slabCount == 0)
+    {
+      return;
+    }
+  Node** combined = new Node*[slabCount + other.slabCount];
+  int total = 0;
+  // our newest slab stays last so nextFree still points into it
+  for (int i = 0; i < slabCount - 1; i++)
+    {
+      combined[total] = slabs[i];
+      total++;
+    }
+  for (int i = 0; i < other.slabCount; i++)
+    {
+      combined[total] = other.slabs[i];
+      total++;
+    }
+  if (slabCount > 0)
+    {
+      combined[total] = slabs[slabCount - 1];
+      total++;
+    }
+  else // we had no slabs, so carry on from the other pool's newest one
+    {
+      nextFree = other.nextFree;
+    }
+  delete[] slabs;
+  slabs = combined;
+  slabCount = total;
+  slabCapacity = total;
+  recycle(other.freeList);
+  inUse += other.inUse;
+
+  // the other pool no longer owns anything
+  delete[] other.slabs;
+  other.slabs = NULL;
+  other.slabCount = 0;
+  other.slabCapacity = 0;
+  other.nextFree = 0;
+  other.freeList = NULL;
+  other.held = NULL;
+  other.inUse = 0;
+}
+
+// releases every node in the pool; any tree built from it is gone
+void NodePool::clear()
+{
+  for (int i = 0; i < slabCount; i++)
+    {
+      delete[] slabs[i];
+    }
+  delete[] slabs;
+  slabs = NULL;
+  slabCount = 0;
+  slabCapacity = 0;
+  nextFree = 0;
+  freeList = NULL;
+  held = NULL;
+  inUse = 0;
+}
+
+// returns how many slabs have been allocated
+int NodePool::getSlabCount()
+{
+  return slabCount;
+}
+
+// returns how many nodes are currently handed out
+int NodePool::getNodesInUse()
+{
+  return inUse;
+}
+
+// allocates another slab, growing the list of slabs if needed
+void NodePool::addSlab()
+{
+  if (slabCount == slabCapacity) // out of room; double the array
+    {
+      int newCapacity = slabCapacity * 2;
+      if (newCapacity == 0)
+	{
+	  newCapacity = 8;
+	}
+      Node** bigger = new Node*[newCapacity];
+      for (int i = 0; i < slabCount; i++)
+	{
+	  bigger[i] = slabs[i];
+	}
+      delete[] slabs;
+      slabs = bigger;
+      slabCapacity = newCapacity;
+    }
+  slabs[slabCount] = new Node[slabSize];
+  slabCount++;
+  nextFree = 0;
+}
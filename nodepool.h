@@ -0,0 +1,49 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+#include <iostream>
+#include "node.h"
+
+/*
+ * A NodePool hands out Nodes from big blocks ("slabs") instead of calling
+ * new once per node. Nodes given back by remove go on a free list and get
+ * reused by the next insert. The whole tree can be released at once.
+ */
+class NodePool
+{
+ public:
+  // constructors and destructors
+  NodePool();
+  NodePool(int);
+  ~NodePool();
+
+  // functions
+  Node* getNode(int); // returns a fresh node holding the value
+  void returnNode(Node*); // puts a removed node on the free list
+  void clear(); // releases every node at once
+
+  // holding returned nodes back (for trees that have readers running)
+  void setHolding(bool); // while on, returned nodes wait on a held list
+  Node* takeHeld(); // returns the held list (linked through left) and empties it
+  void recycle(Node*); // puts a list from takeHeld onto the free list
+  void adopt(NodePool&); // takes over every node (and slab) of another pool
+
+  // functions (getters)
+  int getSlabCount(); // returns how many slabs have been allocated
+  int getNodesInUse(); // returns how many nodes are in the tree
+
+ private:
+  // functions
+  void addSlab(); // allocates another slab of nodes
+
+  // variables
+  Node** slabs; // every slab this pool owns
+  int slabCount;
+  int slabCapacity; // room in the slabs array
+  int slabSize; // nodes per slab
+  int nextFree; // next untouched node in the newest slab
+  Node* freeList; // removed nodes, linked through their left pointers
+  Node* held; // returned nodes that can't be reused yet, linked the same way
+  bool holding; // whether returnNode puts nodes on the held list
+  int inUse;
+};
+#endif
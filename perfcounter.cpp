@@ -0,0 +1,65 @@
+#include <iostream>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perfcounter.h"
+
+using namespace std;
+
+// constructor, which asks the kernel for an instruction counter
+InstructionCounter::InstructionCounter()
+{
+  perf_event_attr attributes;
+  memset(&attributes, 0, sizeof(attributes));
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.size = sizeof(attributes);
+  attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+  attributes.disabled = 1; // start() turns it on
+  attributes.exclude_kernel = 1; // only count our own code
+  attributes.exclude_hv = 1;
+  // this thread, on any CPU
+  fd = syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+// destructor
+InstructionCounter::~InstructionCounter()
+{
+  if (fd >= 0)
+    {
+      close(fd);
+    }
+}
+
+// returns whether counting works here
+bool InstructionCounter::isAvailable()
+{
+  return fd >= 0;
+}
+
+// resets the count and starts counting
+void InstructionCounter::start()
+{
+  if (fd >= 0)
+    {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+// stops counting and returns the count, or -1 if counting doesn't work
+long long InstructionCounter::stop()
+{
+  if (fd < 0)
+    {
+      return -1;
+    }
+  ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  long long count = 0;
+  if (read(fd, &count, sizeof(count)) != sizeof(count))
+    {
+      return -1;
+    }
+  return count;
+}
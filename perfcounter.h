@@ -0,0 +1,32 @@
+#ifndef PERFCOUNTER_H
+#define PERFCOUNTER_H
+#include <iostream>
+
+/*
+ * An InstructionCounter counts how many instructions this thread runs
+ * between start() and stop(), using the CPU's hardware counters through
+ * Linux's perf_event_open. Some machines (many virtual machines and
+ * containers) don't allow that; then isAvailable() is false and stop()
+ * returns -1.
+ */
+class InstructionCounter
+{
+ public:
+  // constructors and destructors
+  InstructionCounter();
+  ~InstructionCounter();
+
+  // functions
+  bool isAvailable(); // returns whether counting works here
+  void start(); // resets the count and starts counting
+  long long stop(); // stops and returns the count, or -1 if not available
+
+ private:
+  // variables
+  int fd; // the perf event, or -1
+
+  // not copyable
+  InstructionCounter(const InstructionCounter&);
+  InstructionCounter& operator=(const InstructionCounter&);
+};
+#endif
@@ -0,0 +1,486 @@
+#include <iostream>
+#include "persistenttree.h"
+#include "trace.h"
+
+using namespace std;
+
+// a red-black tree with 2^32 nodes is at most 64 levels tall; removal can
+// push one more node onto the path when it rotates a red sibling up
+static const int MAX_PATH = 130;
+
+// returns whether a node is red; NULL children count as black
+static bool isRed(PersistentNode* node)
+{
+  return node != NULL && !node->black;
+}
+
+// returns the left child if onRight is false, or the right child if true,
+// as something that can be assigned to
+static PersistentNode* &childOf(PersistentNode* node, bool onRight)
+{
+  if (onRight)
+    {
+      return node->right;
+    }
+  return node->left;
+}
+
+// adds a reference to a node (NULL is fine)
+static void addRef(PersistentNode* node)
+{
+  if (node != NULL)
+    {
+      node->refs.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+// default constructor
+PersistentTree::PersistentTree()
+{
+  root = NULL;
+  version = 0;
+  writeNumber = 0;
+  size = 0;
+  nodeCount.store(0);
+  copyCount = 0;
+}
+
+// destructor; every snapshot should have been released by now
+PersistentTree::~PersistentTree()
+{
+  dropRef(root);
+}
+
+/**
+ * This function adds a value, making a new version. The path down is
+ * claimed (see own()) as the walk goes, and then the fix-up works on the
+ * claimed nodes, copying the uncle too if it has to be recolored.
+ */
+bool PersistentTree::insert(int key)
+{
+  lock_guard<mutex> guard(lock);
+  if (search(root, key))
+    {
+      return false;
+    }
+  writeNumber++;
+  if (root == NULL)
+    {
+      root = newNode(key);
+      root->black = true;
+      size++;
+      version++;
+      return true;
+    }
+
+  PersistentNode* path[MAX_PATH];
+  bool wentRight[MAX_PATH]; // which child we took at each node on the path
+  int depth = 0;
+  path[0] = own(root);
+  depth = 1;
+  while (true)
+    {
+      PersistentNode* current = path[depth - 1];
+      bool goRight = key > current->data;
+      wentRight[depth - 1] = goRight;
+      PersistentNode* &slot = childOf(current, goRight);
+      if (slot == NULL)
+	{
+	  slot = newNode(key);
+	  path[depth] = slot;
+	  depth++;
+	  break;
+	}
+      path[depth] = own(slot);
+      depth++;
+    }
+
+  // fix a red node under a red parent, same cases as fixInsert()
+  int i = depth - 1; // where the (red) node is on the path
+  while (i >= 2 && isRed(path[i - 1]))
+    {
+      PersistentNode* parent = path[i - 1];
+      PersistentNode* grandparent = path[i - 2];
+      bool parentIsRight = wentRight[i - 2];
+      PersistentNode* &uncle = childOf(grandparent, !parentIsRight);
+      if (isRed(uncle)) // push the red up to the grandparent
+	{
+	  TRACE(TRACE_INSERT_CASE3, path[i]->data);
+	  own(uncle)->black = true;
+	  parent->black = true;
+	  grandparent->black = false;
+	  i -= 2;
+	  continue;
+	}
+      if (wentRight[i - 1] != parentIsRight) // node is on the inside
+	{
+	  TRACE(TRACE_INSERT_CASE4, path[i]->data);
+	  rotate(slotOf(path, wentRight, i - 1), parentIsRight);
+	}
+      // whatever is above the grandparent now (node or parent) goes up
+      TRACE(TRACE_INSERT_CASE5, path[i]->data);
+      childOf(grandparent, parentIsRight)->black = true;
+      grandparent->black = false;
+      rotate(slotOf(path, wentRight, i - 2), !parentIsRight);
+      break;
+    }
+  root->black = true;
+  size++;
+  version++;
+  return true;
+}
+
+/**
+ * This function removes a value, making a new version. A node with two
+ * children takes its successor's value and the successor is unlinked
+ * instead, like remove() does. If a black node comes out, the fix-up
+ * goes back up the path, copying each sibling (and nephew) before it
+ * recolors or rotates it.
+ */
+bool PersistentTree::remove(int key)
+{
+  lock_guard<mutex> guard(lock);
+  if (!search(root, key))
+    {
+      return false;
+    }
+  writeNumber++;
+
+  PersistentNode* path[MAX_PATH];
+  bool wentRight[MAX_PATH];
+  int depth = 0;
+  path[0] = own(root);
+  depth = 1;
+  PersistentNode* found = NULL;
+  while (true)
+    {
+      PersistentNode* current = path[depth - 1];
+      bool goRight;
+      if (found == NULL && key == current->data)
+	{
+	  found = current;
+	  if (current->left == NULL || current->right == NULL)
+	    {
+	      break; // this node can be unlinked itself
+	    }
+	  goRight = true; // on to the successor
+	}
+      else if (found != NULL) // looking for the successor
+	{
+	  if (current->left == NULL)
+	    {
+	      break;
+	    }
+	  goRight = false;
+	}
+      else
+	{
+	  goRight = key > current->data;
+	}
+      wentRight[depth - 1] = goRight;
+      path[depth] = own(childOf(current, goRight));
+      depth++;
+    }
+
+  // unlink the last node on the path; its only child (if any) moves up
+  PersistentNode* unlinked = path[depth - 1];
+  found->data = unlinked->data;
+  PersistentNode* child = unlinked->left;
+  if (child == NULL)
+    {
+      child = unlinked->right;
+    }
+  PersistentNode* &slot = slotOf(path, wentRight, depth - 1);
+  slot = child; // child changes parents, so its count stays the same
+  bool removedBlack = unlinked->black;
+  unlinked->left = NULL;
+  unlinked->right = NULL;
+  dropRef(unlinked);
+  size--;
+  version++;
+
+  if (removedBlack && isRed(child))
+    {
+      own(slot)->black = true;
+    }
+  else if (removedBlack)
+    {
+      // the spot at i is one black short; same cases as deleteByCase()
+      int i = depth - 1;
+      while (i > 0 && !isRed(slotOf(path, wentRight, i)))
+	{
+	  PersistentNode* parent = path[i - 1];
+	  bool nodeIsRight = wentRight[i - 1];
+	  PersistentNode* sibling = own(childOf(parent, !nodeIsRight));
+	  if (!sibling->black) // make the sibling black by rotating it up
+	    {
+	      TRACE(TRACE_DELETE_CASE2, parent->data);
+	      sibling->black = true;
+	      parent->black = false;
+	      rotate(slotOf(path, wentRight, i - 1), nodeIsRight);
+	      // the sibling is now above the parent on the path
+	      path[i - 1] = sibling;
+	      wentRight[i - 1] = nodeIsRight;
+	      path[i] = parent;
+	      wentRight[i] = nodeIsRight;
+	      i++;
+	      continue;
+	    }
+	  if (!isRed(sibling->left) && !isRed(sibling->right))
+	    {
+	      TRACE(TRACE_DELETE_CASE3, parent->data);
+	      sibling->black = false;
+	      i--; // the parent is now the one short, unless it was red
+	      continue;
+	    }
+	  PersistentNode* far = childOf(sibling, !nodeIsRight);
+	  if (!isRed(far)) // turn the near nephew into the far one
+	    {
+	      TRACE(TRACE_DELETE_CASE5, parent->data);
+	      own(childOf(sibling, nodeIsRight))->black = true;
+	      sibling->black = false;
+	      rotate(childOf(parent, !nodeIsRight), !nodeIsRight);
+	      sibling = childOf(parent, !nodeIsRight);
+	    }
+	  TRACE(TRACE_DELETE_CASE6, parent->data);
+	  sibling->black = parent->black;
+	  parent->black = true;
+	  own(childOf(sibling, !nodeIsRight))->black = true;
+	  rotate(slotOf(path, wentRight, i - 1), nodeIsRight);
+	  i = 0;
+	  break;
+	}
+      if (i > 0)
+	{
+	  // a red node soaks up the missing black
+	  slotOf(path, wentRight, i)->black = true;
+	}
+    }
+  if (root != NULL)
+    {
+      root->black = true;
+    }
+  return true;
+}
+
+/**
+ * This function hands out the current version. The snapshot holds a
+ * reference on its root, so every node in it stays around (and stays
+ * the same) until releaseSnapshot() is called with it.
+ */
+PersistentNode* PersistentTree::takeSnapshot()
+{
+  lock_guard<mutex> guard(lock);
+  addRef(root);
+  return root;
+}
+
+// gives back a snapshot; nodes only it was using are deleted
+void PersistentTree::releaseSnapshot(PersistentNode* snapshot)
+{
+  dropRef(snapshot);
+}
+
+// returns whether key is in a snapshot
+bool PersistentTree::search(PersistentNode* snapshot, int key)
+{
+  PersistentNode* current = snapshot;
+  while (current != NULL)
+    {
+      if (key == current->data)
+	{
+	  return true;
+	}
+      current = childOf(current, key > current->data);
+    }
+  return false;
+}
+
+/**
+ * This function copies the values of a snapshot from low up to (but not
+ * including) high into values, stopping after max of them. Returns how
+ * many values were copied.
+ */
+int PersistentTree::rangeScan(PersistentNode* snapshot, int low, int high,
+			      int* values, int max)
+{
+  PersistentNode* stack[MAX_PATH]; // nodes >= low not copied yet
+  int stackSize = 0;
+  int count = 0;
+  PersistentNode* current = snapshot;
+  while (count < max)
+    {
+      while (current != NULL)
+	{
+	  if (current->data < low)
+	    {
+	      current = current->right;
+	    }
+	  else
+	    {
+	      stack[stackSize] = current;
+	      stackSize++;
+	      current = current->left;
+	    }
+	}
+      if (stackSize == 0)
+	{
+	  break;
+	}
+      stackSize--;
+      if (stack[stackSize]->data >= high)
+	{
+	  break;
+	}
+      values[count] = stack[stackSize]->data;
+      count++;
+      current = stack[stackSize]->right;
+    }
+  return count;
+}
+
+// returns how many values are in a snapshot (it walks the whole thing)
+int PersistentTree::countValues(PersistentNode* snapshot)
+{
+  if (snapshot == NULL)
+    {
+      return 0;
+    }
+  return 1 + countValues(snapshot->left) + countValues(snapshot->right);
+}
+
+// looks for a value in the current version
+bool PersistentTree::search(int key)
+{
+  lock_guard<mutex> guard(lock);
+  return search(root, key);
+}
+
+// returns the number of values in the current version
+int PersistentTree::getSize()
+{
+  lock_guard<mutex> guard(lock);
+  return size;
+}
+
+// returns how many writes changed the tree (the current version number)
+uint64_t PersistentTree::getVersion()
+{
+  lock_guard<mutex> guard(lock);
+  return version;
+}
+
+/**
+ * This function returns how many nodes exist right now, across the
+ * current version and every snapshot still held. Compare it to the sum
+ * of countValues() over those versions to see how much they share.
+ */
+long PersistentTree::getNodeCount()
+{
+  return nodeCount.load();
+}
+
+// returns how many nodes writes have had to copy so far
+long PersistentTree::getCopyCount()
+{
+  lock_guard<mutex> guard(lock);
+  return copyCount;
+}
+
+// makes a red node for the running write
+PersistentNode* PersistentTree::newNode(int value)
+{
+  PersistentNode* node = new PersistentNode;
+  node->data = value;
+  node->black = false;
+  node->refs.store(1, memory_order_relaxed);
+  node->stamp = writeNumber;
+  node->left = NULL;
+  node->right = NULL;
+  nodeCount.fetch_add(1, memory_order_relaxed);
+  return node;
+}
+
+/**
+ * This function makes sure the node in slot belongs to the running write,
+ * so it can be changed. slot has to be in a node that already belongs to
+ * it (or be the root). If nothing but slot points at the node, no
+ * snapshot can reach it and it is just claimed; otherwise it is copied,
+ * the copy takes its place in slot, and the old node stays in the
+ * versions that still use it. Returns the node that is now in slot.
+ */
+PersistentNode* PersistentTree::own(PersistentNode* &slot)
+{
+  PersistentNode* node = slot;
+  if (node->stamp == writeNumber)
+    {
+      return node;
+    }
+  if (node->refs.load(memory_order_acquire) == 1)
+    {
+      node->stamp = writeNumber;
+      return node;
+    }
+  PersistentNode* copy = newNode(node->data);
+  copy->black = node->black;
+  copy->left = node->left;
+  copy->right = node->right;
+  addRef(copy->left);
+  addRef(copy->right);
+  copyCount++;
+  slot = copy;
+  dropRef(node); // slot doesn't point at it any more
+  return copy;
+}
+
+/**
+ * This function takes away a reference to a node, deleting it if that was
+ * the last one (which takes away its references to its children too).
+ * Readers releasing snapshots and the writer can both get here at once,
+ * so the count is atomic.
+ */
+void PersistentTree::dropRef(PersistentNode* node)
+{
+  if (node == NULL || node->refs.fetch_sub(1, memory_order_acq_rel) != 1)
+    {
+      return;
+    }
+  dropRef(node->left);
+  dropRef(node->right);
+  delete node;
+  nodeCount.fetch_sub(1, memory_order_relaxed);
+}
+
+// returns the pointer that holds path[i]: the root, or a child of path[i-1]
+PersistentNode* &PersistentTree::slotOf(PersistentNode** path,
+					bool* wentRight, int i)
+{
+  if (i == 0)
+    {
+      return root;
+    }
+  return childOf(path[i - 1], wentRight[i - 1]);
+}
+
+/**
+ * This function rotates the node in slot like rightRotation (goRight =
+ * true) or leftRotation do. Both it and the child that rises must belong
+ * to the running write. Every node still has the same number of parents
+ * afterwards, so no counts change.
+ */
+void PersistentTree::rotate(PersistentNode* &slot, bool goRight)
+{
+  PersistentNode* node = slot;
+  if (goRight)
+    {
+      TRACE(TRACE_RIGHT_ROTATION, node->data);
+    }
+  else
+    {
+      TRACE(TRACE_LEFT_ROTATION, node->data);
+    }
+  PersistentNode* risen = childOf(node, !goRight);
+  childOf(node, !goRight) = childOf(risen, goRight);
+  childOf(risen, goRight) = node;
+  slot = risen;
+}
@@ -0,0 +1,87 @@
+#ifndef PERSISTENTTREE_H
+#define PERSISTENTTREE_H
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+/*
+ * A node in a PersistentTree. There is no parent pointer: a node can be
+ * in many versions of the tree at once, under a different parent in each.
+ * refs counts the parents (and snapshots) pointing at it, so it can be
+ * deleted when the last version using it goes away.
+ */
+struct PersistentNode
+{
+  int data;
+  bool black;
+  std::atomic<int> refs;
+  uint64_t stamp; // the write that made (or claimed) this node
+  PersistentNode* left;
+  PersistentNode* right;
+};
+
+/*
+ * A PersistentTree is a red-black tree where every write makes a new
+ * version and leaves the old ones alone. insert and remove copy each node
+ * they are about to change (the path down, plus any uncle, sibling or
+ * nephew the fix-up recolors or rotates) and leave everything else shared
+ * with the version before. A node that no snapshot can reach any more is
+ * just changed in place instead of copied.
+ *
+ * takeSnapshot() hands out the current root, and nothing reachable from
+ * it ever changes, so a report can read it for as long as it likes (from
+ * any thread, without a lock) while writes carry on. Every snapshot has
+ * to be given back with releaseSnapshot() before the tree is destroyed.
+ *
+ * Since there are no parent pointers, the fix-ups work from a stack of
+ * the nodes on the path, like insertWithPath() in redblack.h.
+ */
+class PersistentTree
+{
+ public:
+  // constructors and destructors
+  PersistentTree();
+  ~PersistentTree();
+
+  // functions (writers)
+  bool insert(int); // returns false if the value is already there
+  bool remove(int); // returns false if the value wasn't there
+
+  // functions (snapshots)
+  PersistentNode* takeSnapshot(); // the current version; NULL if empty
+  void releaseSnapshot(PersistentNode*);
+  static bool search(PersistentNode* snapshot, int key);
+  static int rangeScan(PersistentNode* snapshot, int low, int high,
+		       int* values, int max);
+  static int countValues(PersistentNode* snapshot);
+
+  // functions (getters)
+  bool search(int); // looks in the current version
+  int getSize(); // returns the number of values in the current version
+  uint64_t getVersion(); // returns how many writes changed the tree
+  long getNodeCount(); // returns how many nodes all versions use together
+  long getCopyCount(); // returns how many nodes writes have copied
+
+ private:
+  // functions
+  PersistentNode* newNode(int value);
+  PersistentNode* own(PersistentNode* &slot);
+  void dropRef(PersistentNode* node);
+  PersistentNode* &slotOf(PersistentNode** path, bool* wentRight, int i);
+  void rotate(PersistentNode* &slot, bool goRight);
+
+  // variables
+  PersistentNode* root; // the current version
+  uint64_t version;
+  uint64_t writeNumber; // nodes stamped with it belong to the running write
+  int size;
+  std::atomic<long> nodeCount;
+  long copyCount;
+  std::mutex lock; // for writers and takeSnapshot
+
+  // not copyable
+  PersistentTree(const PersistentTree&);
+  PersistentTree& operator=(const PersistentTree&);
+};
+#endif
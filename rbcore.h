@@ -0,0 +1,607 @@
+#ifndef RBCORE_H
+#define RBCORE_H
+#include <iostream>
+#include "trace.h"
+
+/*
+ * These are the red-black balancing routines that every pointer-based
+ * tree in this repo shares: the insert fix-up, the rotations, and the
+ * removal fix-up with its six cases. The int tree in redblack.cpp, the
+ * generic RedBlackTree in redblacktree.h and the IntervalTree all call
+ * these, so a fix here fixes all three.
+ *
+ * They work on any node type N that has the same getters and setters as
+ * Node: getLeft, getRight, getParent, getColor and setLeft, setRight,
+ * setParent, setColor (colors are 'r' and 'b'). Two more functions have
+ * to be declared for N before these are used:
+ *   updateNode(N*)   works out whatever the node keeps about its subtree
+ *                    (a size, a largest endpoint) from its children; the
+ *                    rotations call it on the two nodes they move
+ *   traceKey(N*)     returns the int that TRACE records for the node
+ *
+ * A removal keeps the node that is leaving in the tree while fixRemove
+ * runs, and only then takes it out (see unlinkNode). Anything a node
+ * keeps about its subtree should already leave the leaving node out, the
+ * way remove() takes it off the sizes with adjustSizes() first.
+ */
+
+// insertion
+template <class N> void fixInsert(N* &root, N* newnode);
+
+// general operations
+template <class N> void rightRotation(N* current, N* &root);
+template <class N> void leftRotation(N* current, N* &root);
+template <class N> int childStatus(N* node);
+template <class N> N* getUncle(N* node);
+template <class N> N* getSibling(N* node);
+template <class N> void swapColor(N* a, N* b);
+
+// deletion
+template <class N> void unlinkNode(N* &root, N* node);
+template <class N> void fixRemove(N* &root, N* node, N* deleted);
+template <class N> void deleteByCase(N* node, N* deleted, N* &root);
+
+/**
+ * This function is called by each insert once the new node is hung on the
+ * tree. This is because a new node in the red black tree is automatically
+ * inserted as a red node in a standard binary search tree. Doing this may violate properties of
+ * a red-black tree, so this separate function is designed specifically to
+ * fix the violations on a case-by case basis:
+ * 
+ * Case 1: if the new node is the root, change its color to black.
+ * Case 2: the new node's parent is black. No violations.
+ * Case 3: Both the new node's parent, p and uncle, u are RED. Change p and u
+ * to BLACK, change grandparent g to RED, and go around the loop again
+ * with g.
+ * Case 4: p is RED, u is BLACK or NULL, and new node is the inner grandchild.
+ * Case 5: p is RED, u is BLACK or NULL, and new node is the outer grandchild.
+ */
+template <class N>
+void fixInsert(N* &root, N* newnode)
+{
+  while (newnode != NULL)
+    {
+      // CASE 1: new node is the root. Just set it to black
+      if (newnode == root) // case 1
+	{
+	  TRACE(TRACE_INSERT_CASE1, traceKey(newnode));
+	  root->setColor('b');
+	  return;
+	}
+
+      // CASE 2: newnode's parent is black
+      else if (newnode->getParent()->getColor() == 'b') // case 2
+	{
+	  // no violations
+	  TRACE(TRACE_INSERT_CASE2, traceKey(newnode));
+	  return;
+	}
+
+      // CASE 3: Parent and the uncle are RED
+      else if (newnode->getParent()->getColor() == 'r' &&
+	       getUncle(newnode) && getUncle(newnode)->getColor() == 'r') // case 3
+	{
+	  TRACE(TRACE_INSERT_CASE3, traceKey(newnode));
+	  N* grandparent = NULL;
+	  if (newnode->getParent()->getParent())
+	    {
+	      grandparent = newnode->getParent()->getParent();
+	    }
+	  N* uncle = getUncle(newnode);
+
+	  // set the parent node to black to fix the red-black property violation
+	  newnode->getParent()->setColor('b');
+	  if (uncle) // if uncle exists
+	    {
+	      uncle->setColor('b');
+	    }
+	  if (grandparent) // if grandparent exists
+	    {
+	      grandparent->setColor('r');
+	    }
+	  newnode = grandparent; // fix any new violations
+	}
+
+      // CASE 4: Uncle is black, and newnode is the inner grandchild (triangle)
+      // childstatus 1 is left child, childstatus 2 is right child
+      // CASE 5: Uncle is black, and newnode is the outer grandchild (line)
+      else if (newnode->getParent()->getColor() == 'r' &&
+	       ((getUncle(newnode) && getUncle(newnode)->getColor() == 'b') ||
+		getUncle(newnode) == NULL)) // null children are black
+	{
+	  N* parent = newnode->getParent();
+	  N* grandparent = newnode->getParent()->getParent();
+
+	  // CASE 4
+	  // right inner grandchild
+	  if (childStatus(newnode) == 2 &&
+	      childStatus(parent) == 1)
+	    {
+	      TRACE(TRACE_INSERT_CASE4, traceKey(newnode));
+	      // tree rotation through the node's parent in the OPPOSITE direction
+	      leftRotation(parent, root);
+	      newnode = parent; // go around again for case 5 on the parent node
+	    }
+	  // left inner grandchild
+	  else if (childStatus(newnode) == 1 &&
+		   childStatus(parent) == 2)
+	    {
+	      TRACE(TRACE_INSERT_CASE4, traceKey(newnode));
+	      // tree rotation in the opposite direction
+	      rightRotation(parent, root);
+	      newnode = parent;
+	    }
+
+	  // CASE 5
+	  // left outer grandchild
+	  else if (childStatus(newnode) == 1 &&
+		   childStatus(parent) == 1)
+	    {
+	      TRACE(TRACE_INSERT_CASE5, traceKey(newnode));
+	      // tree rotation through the grandparent
+	      if (grandparent) // if grandparent is not null
+		{
+		  rightRotation(grandparent, root);
+		  swapColor(parent, grandparent);
+		}
+	      return;
+	    }
+	  // right outer grandchild
+	  else if (childStatus(newnode) == 2 &&
+		   childStatus(parent) == 2)
+	    {
+	      TRACE(TRACE_INSERT_CASE5, traceKey(newnode));
+	      if (grandparent)
+		{
+		  leftRotation(grandparent, root);
+		  swapColor(parent, grandparent);
+		}
+	      return;
+	    }
+	  else
+	    {
+	      return;
+	    }
+	}
+      else // no case matched, which a valid tree never gets to
+	{
+	  TRACE(TRACE_INSERT_UNEXPECTED, traceKey(newnode));
+	  return;
+	}
+    }
+}
+
+/**
+ * This function indicates whether the current node is a right or left child
+ */
+template <class N>
+int childStatus(N* node)
+{
+  if (node) // if the node is not null
+    {
+      if (node->getParent()->getLeft() != NULL &&
+	  node->getParent()->getLeft() == node)
+	{
+	  // the current node is a left child
+	  return 1; // 1 = left
+	}
+      else if (node->getParent()->getRight() != NULL &&
+	       node->getParent()->getRight() == node)
+	{
+	  // the current node is a right child
+	  return 2; // 2 = right child
+	}
+    }
+  return 0; // if we have some other situation going on
+}
+
+/**
+ * This function will return the node that is the current node's uncle, or 
+ * the sibling to the parent node
+ */
+
+template <class N>
+N* getUncle(N* node)
+{
+  if (childStatus(node->getParent()) == 1) // parent is the left child
+    {
+      // returns the RIGHT child of the grandparent
+      return node->getParent()->getParent()->getRight();
+    }
+  else if (childStatus(node->getParent()) == 2) // parent is the right child
+  {
+    return node->getParent()->getParent()->getLeft(); // parent is left child
+  }
+  else
+    {
+      return NULL;
+    }
+}
+
+template <class N>
+N* getSibling(N* node)
+{
+  if (childStatus(node) == 1) // node is a left child
+    {
+      if (node->getParent()->getRight())
+	{
+	  return node->getParent()->getRight();
+	}
+    }
+  else if (childStatus(node) == 2) // node is a right child
+    {
+      if (node->getParent()->getLeft())
+	{
+	  return node->getParent()->getLeft();
+	}
+    }
+  return NULL;
+}
+
+/**
+ * This function performs a right rotation around a given node "current."
+ */
+template <class N>
+void rightRotation(N* current, N* &root)
+{
+  TRACE(TRACE_RIGHT_ROTATION, traceKey(current));
+  // if the right subtree of the left child exists
+  if (current->getLeft())
+    {
+      N* rightSubtree = NULL;
+      N* rotated = current->getLeft(); // this will take current's place
+      if (rotated->getRight())
+	{
+	  rightSubtree = rotated->getRight();
+	}
+      if (current->getParent()) // if the rotated node is NOT the root
+	{
+	  // set left child's parent as the grandparent
+	  rotated->setParent(current->getParent());
+
+	  // depending on whether current itself was a left or right child
+	  // current's left child will take the place of current
+	  if (childStatus(current) == 1) // left child
+	    {
+	      current->getParent()->setLeft(rotated);
+	    }
+	  else if (childStatus(current) == 2) // right child
+	    {
+	      current->getParent()->setRight(rotated);
+	    }
+	}
+      else if (!current->getParent()) // the rotated node IS the root
+	{
+	  // in this case, there is no parent
+	  // we have to redefine the root as the rotated node
+	  root = rotated;
+	  root->setParent(NULL);
+	}
+
+      current->setParent(rotated); // current becomes the right subtree
+      rotated->setRight(current);
+
+      // the old right subtree becomes current's left subtree
+      current->setLeft(rightSubtree);
+      if (rightSubtree) // make sure right subtree isn't null
+	{
+	  rightSubtree->setParent(current);
+	}
+
+      // current is now below rotated, so fix its summary (size, largest
+      // endpoint) first
+      updateNode(current);
+      updateNode(rotated);
+    }
+}
+
+/**
+ * This function performs a left rotation around a given node "current."
+ */
+template <class N>
+void leftRotation(N* current, N* &root)
+{
+  TRACE(TRACE_LEFT_ROTATION, traceKey(current));
+  // if the right subtree of the left child exists
+  if (current->getRight())
+    {
+      N* rotated = current->getRight(); // this will take current's place
+      N* leftSubtree = NULL;
+      if (rotated->getLeft())
+	{
+	  leftSubtree = rotated->getLeft();
+	}
+      if (current->getParent() != NULL) // if the rotated node is NOT the root
+	{
+	  // set right child's parent as the grandparent
+	  rotated->setParent(current->getParent());
+
+	  // depending on whether current itself was a left or right child
+	  // current's right child will take the place of current
+	  if (childStatus(current) == 1) // left child
+	    {
+	      current->getParent()->setLeft(rotated);
+	    }
+	  else if (childStatus(current) == 2) // right child
+	    {
+	      current->getParent()->setRight(rotated);
+	    }
+	}
+      else if (current == root) // rotated node IS the root
+	{
+	  root = rotated;
+	  root->setParent(NULL);
+	}
+
+      current->setParent(rotated); // current becomes the left subtree
+      rotated->setLeft(current);
+
+      // the old left subtree becomes current's right subtree
+      current->setRight(leftSubtree);
+      if (leftSubtree) // make sure left subtree isn't null
+	{
+	  leftSubtree->setParent(current);
+	}
+
+      // current is now below rotated, so fix its summary first
+      updateNode(current);
+      updateNode(rotated);
+    }
+}
+
+/**
+ * This function swaps the colors of two nodes, a and b
+ */
+template <class N>
+void swapColor(N* a, N* b)
+{
+  char aColor = a->getColor();
+  a->setColor(b->getColor());
+  b->setColor(aColor);
+}
+
+/**
+ * This function takes a node with at most one child out of the tree. The
+ * fix-up runs first, while the node is still hanging in the tree, and
+ * then its child (or NULL) takes its place under its parent. The caller
+ * still owns the node afterwards.
+ */
+template <class N>
+void unlinkNode(N* &root, N* node)
+{
+  N* child = node->getLeft();
+  if (child == NULL)
+    {
+      child = node->getRight();
+    }
+  // taking out the last node cannot unbalance anything
+  if (node != root || child != NULL)
+    {
+      fixRemove(root, child, node);
+    }
+
+  N* parent = node->getParent();
+  if (child != NULL) // the child is adopted
+    {
+      child->setParent(parent);
+    }
+  if (parent == NULL) // the node was the root
+    {
+      root = child;
+    }
+  else if (parent->getLeft() == node)
+    {
+      parent->setLeft(child);
+    }
+  else
+    {
+      parent->setRight(child);
+    }
+}
+
+/**
+ * This function fixes violations in the red black tree after removing
+ * a node.
+ * @param node | This is the node that replaces the removed node in the tree.
+ * @param deleted | This is the node that is to be removed from the tree. 
+ */
+template <class N>
+void fixRemove(N* &root, N* node, N* deleted)
+{
+  char ncolor = 'b';
+  char dcolor = 'b';
+  if (deleted)
+    {
+      dcolor = deleted->getColor();
+    }
+  if (node)
+    {
+      ncolor = node->getColor();
+    }
+
+  // PART I: node = red, deleted = black - we have lost one black node
+  if (ncolor == 'r' && dcolor == 'b')
+    {
+      TRACE(TRACE_REMOVE_PART1, traceKey(deleted));
+      // the new node becomes black to replace the black node lost.
+      node->setColor('b');
+    }
+
+  // PART II: node = black, deleted = red
+  else if (ncolor == 'b' && dcolor == 'r')
+    {
+      TRACE(TRACE_REMOVE_PART2, traceKey(deleted));
+      // since deleted is the red node, the total black height of the
+      // tree doesn't change so we're good
+    }
+
+  // PART III: BOTH nodes = black; we have problems with the black height
+  else if (ncolor == 'b' && dcolor == 'b')
+    {
+      TRACE(TRACE_REMOVE_PART3, traceKey(deleted));
+      deleteByCase(node, deleted, root);
+    }
+
+}
+
+/**
+ * In the case during a deletion where both the deleted node and the node 
+ * used to replace the deleted node are BLACK, we must account for six
+ * possible cases of violations. Cases 2, 3 and 5 leave a violation behind,
+ * so the function loops until a case finishes the job.
+ */
+template <class N>
+void deleteByCase(N* node, N* deleted, N* &root)
+{
+  while (true)
+    {
+      N* parent = NULL;
+      N* sibling = NULL;
+      int nChildStatus = 0; // is the deleted node a right or left child?
+
+      if (node && node != root)
+	{
+	  parent = node->getParent();
+	  sibling = getSibling(node);
+	  nChildStatus = childStatus(node);
+	}
+      else // the node was completely deleted and replaced with a null pointer
+	{
+	  // deleted is still hanging in the tree (the fix-up runs before it is
+	  // unlinked), so its sibling and side stand in for the NULL node's
+	  parent = deleted->getParent();
+	  sibling = getSibling(deleted);
+	  nChildStatus = childStatus(deleted);
+	}
+  
+      // CASE 1: the newly replaced node = the new root
+      if (node == root)
+	{
+	  TRACE(TRACE_DELETE_CASE1, traceKey(deleted));
+	  // nothing happens since the black height of the tree is balanced
+	  return;
+	}
+      else // the new node is NOT the root
+	{
+	  // these color shorthands will be used when we're checking cases
+	  char sColor = 'b'; // sibling color
+	  char pColor = parent->getColor(); // parent color;
+	  char rcColor = 'b'; // sibling's right child's color
+	  char lcColor = 'b'; // sibling's left child's color
+
+	  if (sibling)
+	    {
+	      sColor = sibling->getColor();
+	      if (sibling->getRight())
+		{
+		  rcColor = sibling->getRight()->getColor();
+		}
+	      if (sibling->getLeft())
+		{
+		  lcColor = sibling->getLeft()->getColor();
+		}
+	    }
+
+	  // CASE 2: node's sibling, s, is red, everything else is black
+	  if (sColor == 'r' &&
+	      pColor == 'b' &&
+	      rcColor == 'b' &&
+	      lcColor == 'b' &&
+	      sibling)
+	    {
+	      TRACE(TRACE_DELETE_CASE2, traceKey(deleted));
+	      // rotate the sibling through the parent
+	      if (childStatus(sibling) == 2) // right child
+		{
+		  leftRotation(parent, root);
+		}
+	      else if (childStatus(sibling) == 1) // left child
+		{
+		  rightRotation(parent, root);
+		}
+		swapColor(parent, sibling);
+	    
+		// fix any new violations by going around again
+		continue;
+	    }
+
+	  // CASE 3: sibling = black, p, s, n, are all black
+	  else if (sColor == 'b' &&
+		   pColor == 'b' &&
+		   rcColor == 'b' &&
+		   lcColor == 'b')
+	    {
+	      TRACE(TRACE_DELETE_CASE3, traceKey(deleted));
+	      if (sibling)
+		{
+		  // remove 1 black node on the other side of the tree
+		  sibling->setColor('r'); // color sibling red
+		}
+	      node = parent; // fix violations one level up
+	      continue;
+	    }
+
+	  // CASE 4: parent = red, sibling + sibling's children are black
+	  else if (sColor == 'b' &&
+		   pColor == 'r' && // parent = red
+		   rcColor == 'b' &&
+		   lcColor == 'b' &&
+		   sibling)
+	    {
+	      TRACE(TRACE_DELETE_CASE4, traceKey(deleted));
+	      swapColor(parent, sibling);
+	    }
+
+	  // CASE 5: parent = either color, inner niece = red, else = black
+	  if (nChildStatus == 2 && // node is a right child
+		   sColor == 'b' &&
+		   rcColor == 'r' && // inner niece = red
+		   lcColor == 'b' &&
+		   sibling)
+	    {
+	      TRACE(TRACE_DELETE_CASE5, traceKey(deleted));
+	      // rotate through the sibling (rotate OUTWARD)
+	      swapColor(sibling, sibling->getRight());
+	      leftRotation(sibling, root);
+	      continue;
+	    }
+	  else if (nChildStatus == 1 && // node is a left child
+		   sColor == 'b' &&
+		   rcColor == 'b' &&
+		   lcColor == 'r' && // inner niece = red
+		   sibling)
+	    {
+	      TRACE(TRACE_DELETE_CASE5, traceKey(deleted));
+	      swapColor(sibling, sibling->getLeft());
+	      rightRotation(sibling, root);
+	      continue;
+	    }
+
+	  // CASE 6: parent = either color, outer niece = red, sibling = black
+	  // the inner niece can be either color
+	  else if (nChildStatus == 2 && // right child
+		   sColor == 'b' &&
+		   lcColor == 'r' && // outer niece = red
+		   sibling)
+	    {
+	      TRACE(TRACE_DELETE_CASE6, traceKey(deleted));
+	      // rotate AWAY from the sibling's child
+	      rightRotation(parent, root);
+	      swapColor(sibling, parent);
+	      sibling->getLeft()->setColor('b');
+	    }
+	  else if (nChildStatus == 1 && // left child
+		   sColor == 'b' &&
+		   rcColor == 'r' && // outer niece = red
+		   sibling)
+	    {
+	      TRACE(TRACE_DELETE_CASE6, traceKey(deleted));
+	      leftRotation(parent, root);
+	      swapColor(sibling, parent);
+	      sibling->getRight()->setColor('b');
+	    }
+	}
+      return; // none of the cases need another pass
+    }
+}
+#endif
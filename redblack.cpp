@@ -0,0 +1,2098 @@
+#include <iostream>
+#include <algorithm>
+#include <climits>
+#include <thread>
+#include <vector>
+#include "redblack.h"
+#include "treeiterator.h"
+#include "trace.h"
+
+using namespace std;
+
+/**
+ * This function takes in a new node (made by the caller, usually from a
+ * NodePool) which contains a new value. It compares the new node's value to
+ * the root of the binary search tree. If the new value is greater, it goes
+ * down to the right child, and if it is lesser, it goes down the left. This
+ * process is repeated with each node until the new value reaches a left and
+ * establishes its position there. It then readjusts the tree based on the
+ * red black tree cases. The walk down the tree is a loop, so there is no
+ * function call per level. Returns false (and leaves the tree alone) if the
+ * value is already in the tree; the caller still owns newnode in that case.
+ *
+ * @param root | the root of the btree in question
+ * &param current | the node in the btree to start walking down from
+ * @param newnode | the node we want to put in
+ */
+bool insert(Node* &root, Node* current, Node* newnode)
+{
+  if (root == NULL) // empty tree
+    {
+      root = newnode;
+      // since root was inserted as red, we must fix the violations
+      fixInsert(root, newnode);
+      return true;
+    }
+
+  while (current != NULL)
+    {
+      // the new node is smaller than the parent; add to left branch
+      if (newnode->getValue() < current->getValue())
+	{
+	  if (current->getLeft() == NULL) // reached a leaf
+	    {
+	      current->setLeft(newnode);
+	      current->getLeft()->setParent(current); // establish the parent
+	      adjustSizes(current, 1); // every subtree above grew by one
+	      fixInsert(root, newnode);
+	      return true;
+	    }
+	  current = current->getLeft(); // keep moving down the tree
+	}
+
+      // the new node is larger than the parent; add to right branch
+      else if (newnode->getValue() > current->getValue())
+	{
+	  if (current->getRight() == NULL) // reached a leaf
+	    {
+	      current->setRight(newnode);
+	      current->getRight()->setParent(current); // establish the parent
+	      adjustSizes(current, 1); // every subtree above grew by one
+	      fixInsert(root, newnode);
+	      return true;
+	    }
+	  current = current->getRight(); // keep moving down the tree
+	}
+
+      // we cannot have two nodes of the same value
+      else
+	{
+	  TRACE(TRACE_INSERT_DUPLICATE, newnode->getValue());
+	  return false;
+	}
+    }
+  return false;
+}
+
+/**
+ * This function returns the number of nodes in a subtree. An empty
+ * subtree (NULL) has 0 nodes.
+ */
+int sizeOf(Node* node)
+{
+  if (node == NULL)
+    {
+      return 0;
+    }
+  return node->getSize();
+}
+
+/**
+ * This function recomputes a node's subtree size from its children. It is
+ * called on the two nodes that move during a rotation.
+ * Compiling with -DNO_ORDER_STATISTICS turns off all size upkeep (and the
+ * rank and select commands).
+ */
+void updateSize(Node* node)
+{
+#ifndef NO_ORDER_STATISTICS
+  node->setSize(sizeOf(node->getLeft()) + sizeOf(node->getRight()) + 1);
+#else
+  (void)node;
+#endif
+}
+
+/**
+ * This function adds "change" to the size of a node and every node above
+ * it. Insert calls it with +1 from the new node's parent and remove calls
+ * it with -1 from the node that is leaving.
+ */
+void adjustSizes(Node* node, int change)
+{
+#ifndef NO_ORDER_STATISTICS
+  while (node != NULL)
+    {
+      node->setSize(node->getSize() + change);
+      node = node->getParent();
+    }
+#else
+  (void)node;
+  (void)change;
+#endif
+}
+
+/**
+ * These two let the shared balancing code in rbcore.h work on Node: a
+ * rotation recomputes the sizes of the nodes it moves, and a trace event
+ * records the node's value.
+ */
+void updateNode(Node* node)
+{
+  updateSize(node);
+}
+
+int traceKey(Node* node)
+{
+  return node->getValue();
+}
+
+/**
+ * This function returns how many values in the tree are smaller than key.
+ * If key is in the tree, this is its position counting from 0. It walks
+ * down once, adding up the left subtrees it skips, so it is O(log n).
+ */
+int rankOf(Node* root, int key)
+{
+  int smaller = 0;
+  Node* current = root;
+  while (current != NULL)
+    {
+      if (key <= current->getValue())
+	{
+	  current = current->getLeft();
+	}
+      else
+	{
+	  // current and its whole left subtree are smaller than key
+	  smaller += sizeOf(current->getLeft()) + 1;
+	  current = current->getRight();
+	}
+    }
+  return smaller;
+}
+
+/**
+ * This function returns the node holding the k-th smallest value, where
+ * k = 0 is the smallest, or NULL if the tree has k or fewer values.
+ * It uses the subtree sizes to decide which way to go, so it is O(log n).
+ */
+Node* selectKth(Node* root, int k)
+{
+  Node* current = root;
+  while (current != NULL)
+    {
+      int leftSize = sizeOf(current->getLeft());
+      if (k < leftSize) // it is in the left subtree
+	{
+	  current = current->getLeft();
+	}
+      else if (k == leftSize) // exactly leftSize values are smaller
+	{
+	  return current;
+	}
+      else // skip the left subtree and current
+	{
+	  k -= leftSize + 1;
+	  current = current->getRight();
+	}
+    }
+  return NULL;
+}
+
+/**
+ * This function, given a searchkey, removes the requested node from the 
+ * binary tree. The removed node is given back to the pool so a later
+ * insert can reuse it.
+ * If the node is question has no children, the node is simply deleted.
+ * If the node has one child, the child is adopted by the grandparent.
+ * If the node has two children, we must find the next largest node.
+ * This means we go to the right child, then as left as possible. The
+ * left descendant's value is swapped into the original node, and then the
+ * left descendant (which has at most one child) is removed instead.
+ * The walk down the tree is a loop rather than a recursive call.
+ */
+
+void remove(Node* &root, Node* current, int searchkey, NodePool &pool)
+{
+  // walk down the tree until we find the node to remove
+  while (current != NULL && searchkey != current->getValue())
+    {
+      if (searchkey < current->getValue())
+	{
+	  current = current->getLeft();
+	}
+      else
+	{
+	  current = current->getRight();
+	}
+    }
+
+  // This returns if the searchkey isn't found
+  // This shouldn't happen because we have built in a searchkey check
+  // up in the caller
+  if (current == NULL)
+    {
+      return;
+    }
+  
+  // we have found the node to remove
+  if (searchkey == current->getValue())
+    {
+      // the node has two children
+      if (current->getLeft() != NULL && current->getRight() != NULL)
+	{
+	  TRACE(TRACE_REMOVE_TWO_CHILDREN, current->getValue());
+	  // we need to find the next largest node
+	  // go to the right child, then go left as far as possible
+	  Node* nextLargest = current->getRight();
+	  while (nextLargest->getLeft() != NULL)
+	    {
+	      nextLargest = nextLargest->getLeft();
+	    }
+
+	  // swap the value of the next largest and the node to be deleted
+	  int currentValue = current->getValue();
+	  int currentCount = current->getCount();
+	  current->setValue(nextLargest->getValue());
+	  current->setCount(nextLargest->getCount());
+	  nextLargest->setValue(currentValue); // we will remove this node
+	  nextLargest->setCount(currentCount);
+
+	  // nextLargest will only have 0 or 1 children, so remove it instead
+	  current = nextLargest;
+	}
+
+      // current is leaving the tree, so every subtree it is in shrinks by
+      // one (this happens before the fix-up so rotations see the new sizes)
+      adjustSizes(current, -1);
+
+      // current has at most one child now; the child (if any) is adopted
+      // by current's parent, after the fix-up has rebalanced around it
+      if (current->getLeft() == NULL && current->getRight() == NULL)
+	{
+	  TRACE(TRACE_REMOVE_NO_CHILDREN, current->getValue());
+	}
+      else
+	{
+	  TRACE(TRACE_REMOVE_ONE_CHILD, current->getValue());
+	}
+      unlinkNode(root, current);
+
+      pool.returnNode(current); // the node goes back on the free list
+    }
+}
+
+/**
+ * This function displays the binary search tree in a visual manner,
+ * sideways.
+ * 
+ * @param current | the current node we are print out
+ * @param numTabs | the number of indentations required for this node
+ */
+void print(Node* current, int numTabs)
+{
+
+  // if we get to a leaf, we want to jump out of print
+  if (current == NULL)
+    {
+      return; // nothing to print
+    }
+
+  // otherwise, we have not reached a leaf
+  numTabs += 1; // indent one more in
+  print(current->getRight(), numTabs); // recursively print right child
+  cout << endl; // line break
+  for (int i = 1; i < numTabs; i++)
+    {
+      // indent the number of times as stated by numTabs
+      cout << "\t";
+    }
+  cout << current->getValue();
+  if (current->getCount() > 1) // a repeated value in a multiset
+    {
+      cout << " x" << current->getCount();
+    }
+  cout << " (" << current->getColor() << ") ";
+  cout << "\n"; // print the current value
+  print(current->getLeft(), numTabs); // recursively print left child
+}
+
+/**
+ * This function, when given a "searchkey," walks through the
+ * binary tree and determines whether the searchkey is found in the tree.
+ */
+Node* search(Node* current, int searchkey)
+{
+  // we stop when we walk off the bottom of the tree without finding it
+  while (current != NULL)
+    {
+      // the searchkey has been found
+      if (current->getValue() == searchkey)
+	{
+	  return current;
+	}
+
+      // search key is less than current node; go left
+      else if (searchkey < current->getValue())
+	{
+	  current = current->getLeft();
+	}
+      // search key is greater than current node; go right
+      else
+	{
+	  current = current->getRight();
+	}
+    }
+  return NULL;
+}
+
+/**
+ * This function looks up many keys at once and puts what search() would
+ * return for keys[i] in results[i]. Returns how many were found.
+ *
+ * One lookup at a time spends most of its time waiting for the next node
+ * to come in from memory. Here up to SEARCH_LANES lookups are walked
+ * together, one level each in turn: when a lookup moves to a child it
+ * asks for that node to be prefetched and goes on to the other lookups,
+ * so by the time it comes back around the node is (usually) in cache. A
+ * lookup that finishes hands its lane to the next key.
+ */
+int searchBatch(Node* root, int* keys, int count, Node** results)
+{
+  const int SEARCH_LANES = 16;
+  Node* lanes[SEARCH_LANES]; // where each lookup is; NULL if the lane is idle
+  int laneKeys[SEARCH_LANES];
+  int laneIndexes[SEARCH_LANES]; // which key each lane is looking up
+  int next = 0; // the next key to hand to a lane
+  int active = 0;
+  int found = 0;
+  for (int lane = 0; lane < SEARCH_LANES; lane++)
+    {
+      lanes[lane] = NULL;
+      if (next < count && root != NULL)
+	{
+	  lanes[lane] = root;
+	  laneKeys[lane] = keys[next];
+	  laneIndexes[lane] = next;
+	  next++;
+	  active++;
+	}
+    }
+  if (root == NULL)
+    {
+      for (int i = 0; i < count; i++)
+	{
+	  results[i] = NULL;
+	}
+      return 0;
+    }
+
+  while (active > 0)
+    {
+      for (int lane = 0; lane < SEARCH_LANES; lane++)
+	{
+	  Node* current = lanes[lane];
+	  if (current == NULL)
+	    {
+	      continue;
+	    }
+	  int value = current->getValue();
+	  int key = laneKeys[lane];
+	  Node* child = NULL;
+	  if (key == value)
+	    {
+	      results[laneIndexes[lane]] = current;
+	      found++;
+	    }
+	  else
+	    {
+	      if (key < value)
+		{
+		  child = current->getLeft();
+		}
+	      else
+		{
+		  child = current->getRight();
+		}
+	      if (child != NULL) // keep going next time around
+		{
+		  __builtin_prefetch(child);
+		  lanes[lane] = child;
+		  continue;
+		}
+	      results[laneIndexes[lane]] = NULL;
+	    }
+
+	  // this lookup is done; start the next key at the root
+	  if (next < count)
+	    {
+	      lanes[lane] = root;
+	      laneKeys[lane] = keys[next];
+	      laneIndexes[lane] = next;
+	      next++;
+	    }
+	  else
+	    {
+	      lanes[lane] = NULL;
+	      active--;
+	    }
+	}
+    }
+  return found;
+}
+
+/**
+ * This function checks that an array is in non-decreasing order, which is
+ * what the bulk build needs. Repeated values are allowed here; they are
+ * squeezed out in buildSorted.
+ */
+bool isSorted(int* values, int count)
+{
+  for (int i = 1; i < count; i++)
+    {
+      if (values[i] < values[i - 1])
+	{
+	  return false;
+	}
+    }
+  return true;
+}
+
+// returns whether a node is red; NULL children count as black
+static bool isRed(Node* node)
+{
+  return node != NULL && node->getColor() == 'r';
+}
+
+// returns the left child if goRight is false, or the right child if true
+static Node* childOf(Node* node, bool goRight)
+{
+  if (goRight)
+    {
+      return node->getRight();
+    }
+  return node->getLeft();
+}
+
+// sets the left child if onRight is false, or the right child if true
+static void setChild(Node* node, bool onRight, Node* child)
+{
+  if (onRight)
+    {
+      node->setRight(child);
+    }
+  else
+    {
+      node->setLeft(child);
+    }
+}
+
+/**
+ * This function rotates around node like rightRotation (goRight = true)
+ * or leftRotation do, but the caller says where node hangs from (above,
+ * on side aboveRight), so there is no childStatus() check. above is NULL
+ * if node is the root.
+ */
+static void rotateBelow(Node* node, bool goRight, Node* above,
+			bool aboveRight, Node* &root)
+{
+  if (goRight)
+    {
+      TRACE(TRACE_RIGHT_ROTATION, node->getValue());
+    }
+  else
+    {
+      TRACE(TRACE_LEFT_ROTATION, node->getValue());
+    }
+  Node* risen = childOf(node, !goRight);
+  Node* moved = childOf(risen, goRight); // the subtree that changes sides
+  setChild(node, !goRight, moved);
+  if (moved != NULL)
+    {
+      moved->setParent(node);
+    }
+  setChild(risen, goRight, node);
+  node->setParent(risen);
+  risen->setParent(above);
+  if (above == NULL)
+    {
+      root = risen;
+    }
+  else
+    {
+      setChild(above, aboveRight, risen);
+    }
+  updateSize(node);
+  updateSize(risen);
+}
+
+/**
+ * This function does the same thing as insert() and fixInsert(), but the
+ * walk down keeps a stack of the nodes it passed and which way it went at
+ * each one. The fix-up then reads the parent, grandparent, uncle and
+ * which side everything is on straight from that stack, instead of
+ * calling getUncle() and childStatus() over and over (each of which goes
+ * back through the parent pointers). Sizes are raised on the way down.
+ * Returns false if the value is already there; the caller still owns
+ * newnode then.
+ */
+bool insertWithPath(Node* &root, Node* newnode)
+{
+  // a red-black tree with 2^32 nodes is at most 64 levels tall
+  Node* path[128];
+  bool wentRight[128]; // which child we took at each node on the path
+  int depth = 0;
+  int key = newnode->getValue();
+
+  Node* current = root;
+  while (current != NULL)
+    {
+      if (key == current->getValue())
+	{
+	  TRACE(TRACE_INSERT_DUPLICATE, key);
+#ifndef NO_ORDER_STATISTICS
+	  for (int i = 0; i < depth; i++) // take back the size increases
+	    {
+	      path[i]->setSize(path[i]->getSize() - 1);
+	    }
+#endif
+	  return false;
+	}
+      path[depth] = current;
+      wentRight[depth] = (key > current->getValue());
+#ifndef NO_ORDER_STATISTICS
+      current->setSize(current->getSize() + 1);
+#endif
+      current = childOf(current, wentRight[depth]);
+      depth++;
+    }
+
+  newnode->setColor('r');
+  newnode->setSize(1);
+  if (depth == 0)
+    {
+      TRACE(TRACE_INSERT_CASE1, key);
+      root = newnode;
+      root->setParent(NULL);
+      root->setColor('b');
+      return true;
+    }
+  newnode->setParent(path[depth - 1]);
+  setChild(path[depth - 1], wentRight[depth - 1], newnode);
+
+  // node sits at position level of the path (path[level] would be node)
+  Node* node = newnode;
+  int level = depth;
+  while (true)
+    {
+      if (level == 0) // case 1: node is the root
+	{
+	  TRACE(TRACE_INSERT_CASE1, node->getValue());
+	  node->setColor('b');
+	  return true;
+	}
+      Node* parent = path[level - 1];
+      if (parent->getColor() == 'b') // case 2
+	{
+	  TRACE(TRACE_INSERT_CASE2, node->getValue());
+	  return true;
+	}
+
+      // the parent is red, so it isn't the root and there is a grandparent
+      Node* grandparent = path[level - 2];
+      bool parentIsRight = wentRight[level - 2];
+      Node* uncle = childOf(grandparent, !parentIsRight);
+      if (isRed(uncle)) // case 3: recolor and carry on from the grandparent
+	{
+	  TRACE(TRACE_INSERT_CASE3, node->getValue());
+	  parent->setColor('b');
+	  uncle->setColor('b');
+	  grandparent->setColor('r');
+	  node = grandparent;
+	  level -= 2;
+	  continue;
+	}
+
+      Node* above = NULL; // what the grandparent hangs from
+      bool aboveRight = false;
+      if (level >= 3)
+	{
+	  above = path[level - 3];
+	  aboveRight = wentRight[level - 3];
+	}
+      bool nodeIsRight = wentRight[level - 1];
+      if (nodeIsRight != parentIsRight) // case 4: inner grandchild
+	{
+	  TRACE(TRACE_INSERT_CASE4, node->getValue());
+	  rotateBelow(parent, parentIsRight, grandparent, parentIsRight, root);
+	  parent = node; // node is now where the parent was
+	}
+      // case 5: outer grandchild
+      TRACE(TRACE_INSERT_CASE5, node->getValue());
+      rotateBelow(grandparent, !parentIsRight, above, aboveRight, root);
+      parent->setColor('b');
+      grandparent->setColor('r');
+      return true;
+    }
+}
+
+/*
+ * TOP-DOWN INSERTION AND DELETION
+ *
+ * insert() and remove() go down the tree first, then fixInsert() and
+ * fixRemove() walk back up repairing it. The top-down versions repair the
+ * tree on the way down instead, so they are done as soon as they reach
+ * the bottom:
+ * - insertTopDown splits any node with two red children (it turns red and
+ *   they turn black) before going past it, and fixes a red node under a
+ *   red parent right away with one or two rotations. By the time it gets
+ *   to the bottom, the new red node can go under a black parent.
+ * - removeTopDown makes sure the node it is standing on is red (by
+ *   recoloring, or by borrowing from its sibling with rotations) before
+ *   going further, so the node it finally takes out is red and can just
+ *   be unhooked.
+ *
+ * Subtree sizes are kept in the same pass: every node we go past gets the
+ * +1 (or -1) ahead of time. A rotation recomputes the sizes of the two
+ * nodes it moves, so pathSize() puts the +1 back on any of them that is
+ * still above us.
+ */
+
+#ifndef NO_ORDER_STATISTICS
+// returns whether node is one of the few nodes just above current (the
+// rotations below never move anything more than three levels up)
+static bool isAbove(Node* node, Node* current)
+{
+  Node* ancestor = current->getParent();
+  for (int i = 0; i < 3 && ancestor != NULL; i++)
+    {
+      if (ancestor == node)
+	{
+	  return true;
+	}
+      ancestor = ancestor->getParent();
+    }
+  return false;
+}
+
+/**
+ * This function sets a node's size after a rotation. Nodes above current
+ * already include the pending change (+1 for an insert, -1 for a remove),
+ * so it is taken off the children that have it and put on this node if it
+ * is above current too.
+ */
+static void pathSize(Node* node, Node* current, int pending)
+{
+  int size = 1;
+  Node* children[2] = {node->getLeft(), node->getRight()};
+  for (int i = 0; i < 2; i++)
+    {
+      if (children[i] != NULL)
+	{
+	  size += children[i]->getSize();
+	  if (isAbove(children[i], current))
+	    {
+	      size -= pending;
+	    }
+	}
+    }
+  if (isAbove(node, current))
+    {
+      size += pending;
+    }
+  node->setSize(size);
+}
+#endif
+
+/**
+ * This function rotates around node so that its child on the other side
+ * from goRight comes up (goRight = true is a right rotation), then fixes
+ * the sizes of the two nodes that moved.
+ */
+static void rotateOnPath(Node* node, bool goRight, Node* &root,
+			 Node* current, int pending)
+{
+  Node* risen = childOf(node, !goRight);
+  if (goRight)
+    {
+      rightRotation(node, root);
+    }
+  else
+    {
+      leftRotation(node, root);
+    }
+#ifndef NO_ORDER_STATISTICS
+  pathSize(node, current, pending);
+  pathSize(risen, current, pending);
+#else
+  (void)risen;
+  (void)current;
+  (void)pending;
+#endif
+}
+
+/**
+ * This function fixes a red node with a red parent during insertTopDown.
+ * The parent can't be the root (the root is black), so the grandparent
+ * exists, and it is black. If node is an outer grandchild, one rotation
+ * through the grandparent lifts the parent; if it is an inner one, two
+ * rotations lift node itself. Whichever node ends up on top turns black
+ * and the grandparent turns red.
+ */
+static void fixRedPair(Node* &root, Node* node, Node* current, int pending)
+{
+  Node* parent = node->getParent();
+  if (!isRed(node) || !isRed(parent))
+    {
+      return;
+    }
+  Node* grandparent = parent->getParent();
+  bool parentIsRight = (grandparent->getRight() == parent);
+  bool nodeIsRight = (parent->getRight() == node);
+  Node* top = parent;
+  if (nodeIsRight != parentIsRight) // inner grandchild: straighten it out
+    {
+      rotateOnPath(parent, parentIsRight, root, current, pending);
+      top = node;
+    }
+  rotateOnPath(grandparent, !parentIsRight, root, current, pending);
+  top->setColor('b');
+  grandparent->setColor('r');
+}
+
+/**
+ * This function inserts newnode in one pass down the tree. Returns false
+ * (and leaves the tree as a valid tree, with newnode still owned by the
+ * caller) if the value is already there.
+ */
+bool insertTopDown(Node* &root, Node* newnode)
+{
+  int key = newnode->getValue();
+  if (root == NULL)
+    {
+      root = newnode;
+      root->setParent(NULL);
+      root->setColor('b');
+      return true;
+    }
+
+  Node* current = root;
+  while (true)
+    {
+      // split a node with two red children before going past it
+      if (isRed(current->getLeft()) && isRed(current->getRight()))
+	{
+	  if (current != root) // the root can just stay black
+	    {
+	      current->setColor('r');
+	    }
+	  current->getLeft()->setColor('b');
+	  current->getRight()->setColor('b');
+	  fixRedPair(root, current, current, 1);
+	}
+
+      if (key == current->getValue())
+	{
+	  TRACE(TRACE_INSERT_DUPLICATE, key);
+	  // the nodes we went past already counted the new node
+	  adjustSizes(current->getParent(), -1);
+	  return false;
+	}
+      bool goRight = (key > current->getValue());
+      Node* next = childOf(current, goRight);
+      if (next == NULL) // the new node goes here
+	{
+	  newnode->setParent(current);
+	  newnode->setColor('r');
+	  newnode->setSize(1);
+	  if (goRight)
+	    {
+	      current->setRight(newnode);
+	    }
+	  else
+	    {
+	      current->setLeft(newnode);
+	    }
+#ifndef NO_ORDER_STATISTICS
+	  current->setSize(current->getSize() + 1);
+#endif
+	  // every size is right now, so nothing is pending any more
+	  fixRedPair(root, newnode, newnode, 0);
+	  root->setColor('b');
+	  return true;
+	}
+#ifndef NO_ORDER_STATISTICS
+      current->setSize(current->getSize() + 1); // counts the new node
+#endif
+      current = next;
+    }
+}
+
+/**
+ * This function removes key in one pass down the tree. Going down, it
+ * keeps the node it is standing on red:
+ * - If the node and the child we're heading to are both black but the
+ *   other child is red, a rotation lifts that red child above the node,
+ *   and the node turns red.
+ * - If both children are black, the node borrows from its sibling. If the
+ *   sibling's children are both black, the parent, sibling and node just
+ *   swap colors. Otherwise one or two rotations through the parent move a
+ *   red nephew up, and the colors are fixed so the node ends up red.
+ * When the node holding key is passed, the search carries on to the
+ * largest value below it on the left. That value is copied up, and its
+ * (red) node is unhooked. Returns false if key isn't in the tree.
+ */
+bool removeTopDown(Node* &root, int key, NodePool &pool)
+{
+  if (root == NULL)
+    {
+      return false;
+    }
+
+  Node* current = NULL; // NULL stands for a spot just above the root
+  Node* next = root;
+  Node* found = NULL;
+  bool goRight = true; // the root hangs to the right of that spot
+  while (next != NULL)
+    {
+      bool lastRight = goRight; // which side current hangs from
+#ifndef NO_ORDER_STATISTICS
+      if (current != NULL) // going past current; it loses a node
+	{
+	  current->setSize(current->getSize() - 1);
+	}
+#endif
+      Node* parent = current;
+      current = next;
+      goRight = (current->getValue() < key);
+      if (current->getValue() == key)
+	{
+	  found = current;
+	}
+
+      // make current (or the child we're heading to) red
+      if (!isRed(current) && !isRed(childOf(current, goRight)))
+	{
+	  if (isRed(childOf(current, !goRight)))
+	    {
+	      // lift the red child up above current
+	      Node* risen = childOf(current, !goRight);
+	      rotateOnPath(current, goRight, root, current, -1);
+	      current->setColor('r');
+	      risen->setColor('b');
+	    }
+	  else if (parent != NULL)
+	    {
+	      Node* sibling = childOf(parent, !lastRight);
+	      if (sibling != NULL)
+		{
+		  if (!isRed(sibling->getLeft()) && !isRed(sibling->getRight()))
+		    {
+		      // nobody nearby is red; just swap colors
+		      parent->setColor('b');
+		      sibling->setColor('r');
+		      current->setColor('r');
+		    }
+		  else
+		    {
+		      // the sibling has a red child; rotate it over to us
+		      if (isRed(childOf(sibling, lastRight))) // inner nephew
+			{
+			  rotateOnPath(sibling, !lastRight, root, current, -1);
+			}
+		      rotateOnPath(parent, lastRight, root, current, -1);
+		      Node* top = parent->getParent();
+		      current->setColor('r');
+		      top->setColor('r');
+		      top->getLeft()->setColor('b');
+		      top->getRight()->setColor('b');
+		    }
+		}
+	    }
+	}
+      next = childOf(current, goRight);
+    }
+
+  if (found == NULL) // not there; the nodes we went past lost nothing
+    {
+      adjustSizes(current->getParent(), 1);
+      root->setColor('b');
+      return false;
+    }
+
+  // current is the bottom of the path and has at most one child
+  found->setValue(current->getValue());
+  found->setCount(current->getCount());
+  Node* parent = current->getParent();
+  Node* child = current->getLeft();
+  if (child == NULL)
+    {
+      child = current->getRight();
+    }
+  if (parent == NULL)
+    {
+      root = child;
+    }
+  else if (parent->getLeft() == current)
+    {
+      parent->setLeft(child);
+    }
+  else
+    {
+      parent->setRight(child);
+    }
+  if (child != NULL)
+    {
+      child->setParent(parent);
+    }
+  pool.returnNode(current);
+  if (root != NULL)
+    {
+      root->setColor('b');
+    }
+  return true;
+}
+
+/**
+ * This function builds a red-black tree out of a sorted array in one pass,
+ * without calling insert or doing any rotations. The middle value becomes
+ * the root and each half of the array becomes a subtree, so the tree is
+ * as balanced as possible. Every level is full except for the bottom one,
+ * so the bottom level is colored red and everything above it is black.
+ * This way every path from the root to a leaf has the same number of
+ * black nodes. Returns how many repeated values were skipped, so the
+ * caller can report them.
+ *
+ * @param root | the root of the tree; the tree should be empty
+ * @param values | the sorted values to build the tree out of
+ * @param count | the number of values; duplicates are removed from it
+ * @param pool | where the new nodes come from
+ */
+int buildSorted(Node* &root, int* values, int &count, NodePool &pool)
+{
+  // we cannot have two nodes of the same value, so squeeze out repeats
+  int unique = 0;
+  for (int i = 0; i < count; i++)
+    {
+      if (unique == 0 || values[i] != values[unique - 1])
+	{
+	  values[unique] = values[i];
+	  unique++;
+	}
+    }
+  int skipped = count - unique;
+  count = unique;
+
+  // find the bottom level, which is the only level that can be partly full
+  // a tree of height h holds 2^h - 1 nodes when every level is full
+  int redDepth = 0;
+  while ((2 << redDepth) - 1 <= count)
+    {
+      redDepth++;
+    }
+  root = buildSubtree(values, 0, count - 1, NULL, 0, redDepth, pool);
+  return skipped;
+}
+
+/**
+ * This function recursively builds the subtree holding values[start]
+ * through values[end] and returns its root.
+ *
+ * @param parent | the node that the new subtree hangs from
+ * @param depth | how far down the tree the new subtree's root sits
+ * @param redDepth | the depth of the bottom level, which is colored red
+ */
+Node* buildSubtree(int* values, int start, int end, Node* parent,
+		   int depth, int redDepth, NodePool &pool)
+{
+  if (start > end) // nothing left in this half
+    {
+      return NULL;
+    }
+  int middle = start + (end - start) / 2;
+  Node* current = pool.getNode(values[middle]);
+  current->setParent(parent);
+  if (depth == redDepth) // the bottom, partly full level
+    {
+      current->setColor('r');
+    }
+  else
+    {
+      current->setColor('b');
+    }
+  current->setSize(end - start + 1);
+  current->setLeft(buildSubtree(values, start, middle - 1, current,
+				depth + 1, redDepth, pool));
+  current->setRight(buildSubtree(values, middle + 1, end, current,
+				 depth + 1, redDepth, pool));
+  return current;
+}
+
+// a run of sorted values, from start up to (but not including) end
+struct SortedRun
+{
+  int start;
+  int end;
+};
+
+// one subtree that buildParallel hands to a thread
+struct BuildTask
+{
+  int start; // the values the subtree holds, start through end
+  int end;
+  int depth;
+  Node* parent; // the node it hangs from, or NULL for the whole tree
+  bool isLeft; // whether it is the parent's left child
+  Node* built; // the subtree's root, once a thread has built it
+};
+
+// sorts values[start] up to values[end]; each sortUnique thread runs this
+static void sortRun(int* values, int start, int end)
+{
+  sort(values + start, values + end);
+}
+
+/**
+ * This function merges two sorted runs from source into destination. If
+ * unique is true it also leaves out repeated values, and returns how
+ * many values it wrote.
+ */
+static int mergeRuns(int* source, SortedRun a, SortedRun b, int* destination,
+		     bool unique)
+{
+  int i = a.start;
+  int j = b.start;
+  int written = 0;
+  while (i < a.end || j < b.end)
+    {
+      int value = 0;
+      if (j == b.end || (i < a.end && source[i] <= source[j]))
+	{
+	  value = source[i];
+	  i++;
+	}
+      else
+	{
+	  value = source[j];
+	  j++;
+	}
+      if (!unique || written == 0 || value != destination[written - 1])
+	{
+	  destination[written] = value;
+	  written++;
+	}
+    }
+  return written;
+}
+
+/**
+ * This function sorts values using several threads and removes repeated
+ * values. The array is cut into one piece per thread and each piece is
+ * sorted at the same time. Then neighboring pieces are merged in pairs,
+ * again in parallel, until only two are left; the last merge also skips
+ * repeats, so no extra pass is needed for that. Returns how many values
+ * are left; they are at the front of the array.
+ *
+ * @param threads | how many threads to use, counting this one
+ */
+int sortUnique(int* values, int count, int threads)
+{
+  if (threads < 1)
+    {
+      threads = 1;
+    }
+  if (threads > count / 1024) // not worth a thread per handful of values
+    {
+      threads = count / 1024 + 1;
+    }
+
+  // sort one piece per thread
+  vector<SortedRun> runs(threads);
+  vector<thread> workers;
+  for (int t = 0; t < threads; t++)
+    {
+      runs[t].start = (int)((long long)count * t / threads);
+      runs[t].end = (int)((long long)count * (t + 1) / threads);
+      if (t > 0)
+	{
+	  workers.push_back(thread(sortRun, values, runs[t].start, runs[t].end));
+	}
+    }
+  sortRun(values, runs[0].start, runs[0].end);
+  for (size_t i = 0; i < workers.size(); i++)
+    {
+      workers[i].join();
+    }
+
+  if (threads == 1) // just squeeze out the repeats
+    {
+      int unique = 0;
+      for (int i = 0; i < count; i++)
+	{
+	  if (unique == 0 || values[i] != values[unique - 1])
+	    {
+	      values[unique] = values[i];
+	      unique++;
+	    }
+	}
+      return unique;
+    }
+
+  // merge pairs of runs back and forth between values and a spare array
+  int* spare = new int[count];
+  int* source = values;
+  int* destination = spare;
+  while (runs.size() > 2)
+    {
+      vector<SortedRun> merged;
+      workers.clear();
+      for (size_t i = 0; i < runs.size(); i += 2)
+	{
+	  SortedRun both = runs[i];
+	  if (i + 1 < runs.size())
+	    {
+	      both.end = runs[i + 1].end;
+	      workers.push_back(thread(mergeRuns, source, runs[i], runs[i + 1],
+				       destination + runs[i].start, false));
+	    }
+	  else // an odd run out is just copied across
+	    {
+	      copy(source + both.start, source + both.end,
+		   destination + both.start);
+	    }
+	  merged.push_back(both);
+	}
+      for (size_t i = 0; i < workers.size(); i++)
+	{
+	  workers[i].join();
+	}
+      runs = merged;
+      swap(source, destination);
+    }
+
+  // the last merge removes the repeats and has to end up in values
+  int unique = mergeRuns(source, runs[0], runs[1], destination, true);
+  if (destination != values)
+    {
+      copy(destination, destination + unique, values);
+    }
+  delete[] spare;
+  return unique;
+}
+
+/**
+ * This function builds the top of the tree the same way buildSubtree
+ * does, but once it gets splitDepth levels down it stops and writes down
+ * each subtree still to be built as a task instead.
+ */
+static Node* buildTop(int* values, int start, int end, Node* parent,
+		      bool isLeft, int depth, int redDepth, int splitDepth,
+		      NodePool &pool, vector<BuildTask> &tasks)
+{
+  if (start > end)
+    {
+      return NULL;
+    }
+  if (depth == splitDepth)
+    {
+      BuildTask task;
+      task.start = start;
+      task.end = end;
+      task.depth = depth;
+      task.parent = parent;
+      task.isLeft = isLeft;
+      task.built = NULL;
+      tasks.push_back(task);
+      return NULL; // attached once the task is done
+    }
+  int middle = start + (end - start) / 2;
+  Node* current = pool.getNode(values[middle]);
+  current->setParent(parent);
+  if (depth == redDepth)
+    {
+      current->setColor('r');
+    }
+  else
+    {
+      current->setColor('b');
+    }
+  current->setSize(end - start + 1);
+  current->setLeft(buildTop(values, start, middle - 1, current, true,
+			    depth + 1, redDepth, splitDepth, pool, tasks));
+  current->setRight(buildTop(values, middle + 1, end, current, false,
+			     depth + 1, redDepth, splitDepth, pool, tasks));
+  return current;
+}
+
+// builds every step-th task, starting at first, out of its own pool
+static void buildTasks(int* values, BuildTask* tasks, int taskCount,
+		       int first, int step, int redDepth, NodePool* pool)
+{
+  for (int i = first; i < taskCount; i += step)
+    {
+      tasks[i].built = buildSubtree(values, tasks[i].start, tasks[i].end,
+				    tasks[i].parent, tasks[i].depth,
+				    redDepth, *pool);
+    }
+}
+
+/**
+ * This function builds the same tree as buildSorted, using several
+ * threads. The top few levels are built first, then the subtrees hanging
+ * below them are shared out between the threads. Each thread takes nodes
+ * from a pool of its own (a NodePool isn't safe to share), and when they
+ * are all done the subtrees are hooked onto the top levels and pool takes
+ * over the threads' nodes. values must already be sorted with no repeats.
+ *
+ * @param threads | how many threads to use, counting this one
+ */
+void buildParallel(Node* &root, int* values, int count, int threads,
+		   NodePool &pool)
+{
+  int redDepth = 0;
+  while ((2 << redDepth) - 1 <= count)
+    {
+      redDepth++;
+    }
+  if (threads < 1)
+    {
+      threads = 1;
+    }
+
+  // about four subtrees per thread so they even out
+  int splitDepth = 2;
+  while ((1 << splitDepth) < threads * 4)
+    {
+      splitDepth++;
+    }
+  if (threads == 1 || splitDepth >= redDepth) // too small to split up
+    {
+      root = buildSubtree(values, 0, count - 1, NULL, 0, redDepth, pool);
+      return;
+    }
+
+  vector<BuildTask> tasks;
+  root = buildTop(values, 0, count - 1, NULL, false, 0, redDepth,
+		  splitDepth, pool, tasks);
+
+  vector<NodePool*> pools;
+  vector<thread> workers;
+  for (int t = 0; t < threads; t++)
+    {
+      pools.push_back(new NodePool());
+      if (t > 0)
+	{
+	  workers.push_back(thread(buildTasks, values, &tasks[0],
+				   (int)tasks.size(), t, threads, redDepth,
+				   pools[t]));
+	}
+    }
+  buildTasks(values, &tasks[0], (int)tasks.size(), 0, threads, redDepth,
+	     pools[0]);
+  for (size_t i = 0; i < workers.size(); i++)
+    {
+      workers[i].join();
+    }
+
+  // stitch the subtrees onto the top levels
+  for (size_t i = 0; i < tasks.size(); i++)
+    {
+      if (tasks[i].isLeft)
+	{
+	  tasks[i].parent->setLeft(tasks[i].built);
+	}
+      else
+	{
+	  tasks[i].parent->setRight(tasks[i].built);
+	}
+    }
+  for (int t = 0; t < threads; t++)
+    {
+      pool.adopt(*pools[t]);
+      delete pools[t];
+    }
+}
+
+/**
+ * This function loads unsorted values into an empty tree: they are sorted
+ * and de-duplicated by sortUnique, then built by buildParallel. Nothing is
+ * compared against the tree and nothing is rotated. Returns how many
+ * repeated values were skipped (insert() would have refused them).
+ *
+ * @param values | the values to load; this array gets sorted
+ * @param count | the number of values; set to the number actually loaded
+ * @param threads | how many threads to use, counting this one
+ */
+int loadUnsorted(Node* &root, int* values, int &count, int threads,
+		 NodePool &pool)
+{
+  int unique = sortUnique(values, count, threads);
+  int skipped = count - unique;
+  count = unique;
+  buildParallel(root, values, count, threads, pool);
+  return skipped;
+}
+
+/**
+ * This function returns how many nodes a tree has, but stops counting at
+ * limit. With order statistics the root already knows; without them the
+ * tree is walked in order, which costs no more than limit steps.
+ */
+static int countUpTo(Node* root, int limit)
+{
+#ifndef NO_ORDER_STATISTICS
+  return min(sizeOf(root), limit);
+#else
+  int count = 0;
+  for (Node* current = treeBegin(root).getNode();
+       current != NULL && count < limit; current = current->getNext())
+    {
+      count++;
+    }
+  return count;
+#endif
+}
+
+/**
+ * This function inserts a whole batch of keys at once. The batch is
+ * sorted first, so each key goes in just to the right of the one before
+ * it. Instead of starting every insert at the root, we start at the last
+ * node inserted (the "finger") and only climb up as far as we need to.
+ * Keys that are repeated in the batch or already in the tree are skipped
+ * without printing anything; the number skipped is returned instead.
+ * If the batch is at least as big as the tree, it is cheaper to merge the
+ * two and rebuild, so mergeBatch is used for that.
+ *
+ * @param keys | the keys to insert; this array gets sorted
+ * @param count | the number of keys
+ * @return the number of keys that were not inserted
+ */
+int insertBatch(Node* &root, int* keys, int count, NodePool &pool)
+{
+  sort(keys, keys + count);
+
+  // squeeze out keys that are repeated within the batch
+  int unique = 0;
+  for (int i = 0; i < count; i++)
+    {
+      if (unique == 0 || keys[i] != keys[unique - 1])
+	{
+	  keys[unique] = keys[i];
+	  unique++;
+	}
+    }
+  int skipped = count - unique;
+
+  if (unique >= countUpTo(root, unique)) // big batch: merge and rebuild
+    {
+      return skipped + mergeBatch(root, keys, unique, pool);
+    }
+
+  Node* finger = NULL; // the last node inserted
+  for (int i = 0; i < unique; i++)
+    {
+      int key = keys[i];
+
+      // climb up from the finger until we reach a node bigger than key;
+      // key must go somewhere in that node's left subtree
+      Node* current = root;
+      if (finger != NULL)
+	{
+	  current = finger;
+	  while (current->getParent() != NULL && current->getValue() < key)
+	    {
+	      current = current->getParent();
+	    }
+	}
+
+      // walk down from there to the leaf where key belongs
+      Node* parent = NULL;
+      while (current != NULL && current->getValue() != key)
+	{
+	  parent = current;
+	  if (key < current->getValue())
+	    {
+	      current = current->getLeft();
+	    }
+	  else
+	    {
+	      current = current->getRight();
+	    }
+	}
+      if (current != NULL) // already in the tree
+	{
+	  skipped++;
+	  finger = current;
+	  continue;
+	}
+
+      Node* newnode = pool.getNode(key);
+      newnode->setParent(parent);
+      if (key < parent->getValue())
+	{
+	  parent->setLeft(newnode);
+	}
+      else
+	{
+	  parent->setRight(newnode);
+	}
+      adjustSizes(parent, 1); // every subtree above grew by one
+      fixInsert(root, newnode);
+      finger = newnode;
+    }
+  return skipped;
+}
+
+/**
+ * This function merges a sorted batch of unique keys with every value in
+ * the tree and rebuilds the tree from the result with buildSorted. This
+ * is O(n + m) instead of O(m log n), so it wins when the batch is about as
+ * big as the tree. The old nodes go back to the pool and are reused.
+ *
+ * @return the number of batch keys that were already in the tree
+ */
+int mergeBatch(Node* &root, int* keys, int count, NodePool &pool)
+{
+  // count the nodes ourselves; sizes may be compiled out
+  int treeCount = countUpTo(root, INT_MAX);
+  int* merged = new int[treeCount + count];
+  Node** oldNodes = new Node*[treeCount]; // freed once the walk is done
+  int oldCount = 0;
+  int total = 0;
+  int skipped = 0;
+  int i = 0;
+  Node* current = treeBegin(root).getNode();
+
+  // walk the tree in order and the batch side by side, like a merge sort
+  while (current != NULL || i < count)
+    {
+      if (current == NULL ||
+	  (i < count && keys[i] < current->getValue()))
+	{
+	  merged[total] = keys[i];
+	  i++;
+	}
+      else
+	{
+	  if (i < count && keys[i] == current->getValue())
+	    {
+	      skipped++; // the key is already in the tree
+	      i++;
+	    }
+	  merged[total] = current->getValue();
+	  oldNodes[oldCount] = current;
+	  oldCount++;
+	  current = current->getNext();
+	}
+      total++;
+    }
+
+  // give the old nodes back to the pool, then build the new tree
+  for (int j = 0; j < oldCount; j++)
+    {
+      pool.returnNode(oldNodes[j]);
+    }
+  root = NULL;
+  buildSorted(root, merged, total, pool);
+  delete[] oldNodes;
+  delete[] merged;
+  return skipped;
+}
+
+/**
+ * This function returns the black height of a tree: the number of black
+ * nodes on the way from the root down to a leaf (every path has the same
+ * number). It just follows the left children.
+ */
+int blackHeight(Node* root)
+{
+  int height = 0;
+  for (Node* current = root; current != NULL; current = current->getLeft())
+    {
+      if (current->getColor() == 'b')
+	{
+	  height++;
+	}
+    }
+  return height;
+}
+
+/**
+ * This function joins two trees and one node into a single tree, where
+ * every value in left is smaller than middle's and every value in right is
+ * bigger. If the trees have the same black height, middle just becomes
+ * the new root. Otherwise middle goes down the edge of the taller tree
+ * (the right edge of left, or the left edge of right) to a black node with
+ * the same black height as the shorter tree. That node's subtree and the
+ * shorter tree become middle's children, middle is colored red, and
+ * fixInsert repairs any red-red problem on the way back up. This takes
+ * O(difference in black heights) time. Returns the new root.
+ *
+ * @param left | a tree with values smaller than middle's (can be NULL)
+ * @param middle | a node that isn't in either tree
+ * @param right | a tree with values bigger than middle's (can be NULL)
+ */
+Node* join(Node* left, Node* middle, Node* right)
+{
+  middle->setLeft(NULL);
+  middle->setRight(NULL);
+  middle->setParent(NULL);
+  // a red root can always be made black; this keeps the heights simple
+  if (left != NULL)
+    {
+      left->setParent(NULL);
+      left->setColor('b');
+    }
+  if (right != NULL)
+    {
+      right->setParent(NULL);
+      right->setColor('b');
+    }
+  int leftHeight = blackHeight(left);
+  int rightHeight = blackHeight(right);
+
+  if (leftHeight == rightHeight) // middle becomes the root
+    {
+      middle->setColor('b');
+      middle->setLeft(left);
+      middle->setRight(right);
+      if (left != NULL)
+	{
+	  left->setParent(middle);
+	}
+      if (right != NULL)
+	{
+	  right->setParent(middle);
+	}
+      updateSize(middle);
+      return middle;
+    }
+
+  Node* root = NULL;
+  Node* parent = NULL;
+  Node* current = NULL;
+  if (leftHeight > rightHeight)
+    {
+      // go down the right edge of left to a black node as high as right
+      root = left;
+      current = left;
+      int height = leftHeight;
+      while (current != NULL &&
+	     (current->getColor() == 'r' || height != rightHeight))
+	{
+	  if (current->getColor() == 'b')
+	    {
+	      height--;
+	    }
+	  parent = current;
+	  current = current->getRight();
+	}
+      middle->setLeft(current);
+      middle->setRight(right);
+      parent->setRight(middle);
+    }
+  else
+    {
+      // go down the left edge of right to a black node as high as left
+      root = right;
+      current = right;
+      int height = rightHeight;
+      while (current != NULL &&
+	     (current->getColor() == 'r' || height != leftHeight))
+	{
+	  if (current->getColor() == 'b')
+	    {
+	      height--;
+	    }
+	  parent = current;
+	  current = current->getLeft();
+	}
+      middle->setLeft(left);
+      middle->setRight(current);
+      parent->setLeft(middle);
+    }
+
+  if (middle->getLeft() != NULL)
+    {
+      middle->getLeft()->setParent(middle);
+    }
+  if (middle->getRight() != NULL)
+    {
+      middle->getRight()->setParent(middle);
+    }
+  middle->setParent(parent);
+  middle->setColor('r');
+  updateSize(middle);
+  // everything above middle gained the shorter tree and middle itself
+  adjustSizes(parent, sizeOf(middle) - sizeOf(current));
+  fixInsert(root, middle);
+  return root;
+}
+
+/**
+ * This function joins two trees where every value in left is smaller than
+ * every value in right. The largest node of left is split off and used as
+ * the middle node for join. Returns the new root.
+ */
+Node* joinTwo(Node* left, Node* right)
+{
+  if (left == NULL)
+    {
+      return right;
+    }
+  if (right == NULL)
+    {
+      return left;
+    }
+  Node* last = left;
+  while (last->getRight() != NULL)
+    {
+      last = last->getRight();
+    }
+  Node* smaller = NULL;
+  Node* bigger = NULL; // stays empty, since last is the largest
+  Node* found = NULL;
+  split(left, last->getValue(), smaller, bigger, found);
+  return join(smaller, found, right);
+}
+
+/**
+ * This function splits a tree into the values smaller than key (left) and
+ * the values bigger than key (right). If key is in the tree, its node is
+ * taken out on its own and returned in found; otherwise found is NULL.
+ * It walks down to key once, remembering the path, and then goes back up
+ * joining each node on the path (and the subtree it has on the other
+ * side) onto left or right. Doing the joins bottom-up keeps the total time
+ * O(log n). The original tree is used up.
+ */
+void split(Node* root, int key, Node* &left, Node* &right, Node* &found)
+{
+  // a red-black tree with 2^32 nodes is at most 64 levels tall
+  Node* path[128];
+  int depth = 0;
+  found = NULL;
+  Node* current = root;
+  while (current != NULL)
+    {
+      if (key == current->getValue())
+	{
+	  found = current;
+	  break;
+	}
+      path[depth] = current;
+      depth++;
+      if (key < current->getValue())
+	{
+	  current = current->getLeft();
+	}
+      else
+	{
+	  current = current->getRight();
+	}
+    }
+
+  left = NULL;
+  right = NULL;
+  if (found != NULL) // its subtrees are where left and right start from
+    {
+      left = found->getLeft();
+      right = found->getRight();
+      found->setLeft(NULL);
+      found->setRight(NULL);
+      found->setParent(NULL);
+      found->setSize(1);
+    }
+  for (int i = depth - 1; i >= 0; i--)
+    {
+      Node* node = path[i];
+      if (node->getValue() < key) // node and its left subtree are smaller
+	{
+	  left = join(node->getLeft(), node, left);
+	}
+      else
+	{
+	  right = join(right, node, node->getRight());
+	}
+    }
+
+  // the pieces may still point at a node that is now elsewhere
+  if (left != NULL)
+    {
+      left->setParent(NULL);
+      left->setColor('b');
+    }
+  if (right != NULL)
+    {
+      right->setParent(NULL);
+      right->setColor('b');
+    }
+}
+
+// the three set operations, for setOperation
+enum SetOperation
+  {
+    SET_UNION,
+    SET_INTERSECTION,
+    SET_DIFFERENCE
+  };
+
+/**
+ * This function puts every node of a tree on a list (linked through the
+ * left pointers), taking the tree apart as it goes. Left children are
+ * rotated up until there are none, so no stack is needed.
+ */
+static void spillTree(Node* root, Node* &spare)
+{
+  while (root != NULL)
+    {
+      Node* leftChild = root->getLeft();
+      if (leftChild != NULL)
+	{
+	  root->setLeft(leftChild->getRight());
+	  leftChild->setRight(root);
+	  root = leftChild;
+	}
+      else
+	{
+	  Node* next = root->getRight();
+	  root->setLeft(spare);
+	  spare = root;
+	  root = next;
+	}
+    }
+}
+
+static Node* setOperation(SetOperation operation, Node* a, Node* b,
+			  int threads, Node* &spare);
+
+// runs setOperation on another thread
+static void setOperationThread(SetOperation operation, Node* a, Node* b,
+			       int threads, Node** result, Node** spare)
+{
+  *result = setOperation(operation, a, b, threads, *spare);
+}
+
+/**
+ * This function does a set operation on two trees and returns the
+ * result. Both trees are used up. Nodes that don't end up in the result
+ * (repeats, or values that were taken out) are put on the spare list
+ * instead of going back to a pool, so that threads never share a pool.
+ *
+ * The tree a is split around b's root (or b around a's root, depending on
+ * the operation), the two halves are done separately, and the results are
+ * joined back together. The two halves don't touch each other, so while
+ * threads is more than 1 the left half runs on a new thread.
+ */
+static Node* setOperation(SetOperation operation, Node* a, Node* b,
+			  int threads, Node* &spare)
+{
+  if (a == NULL || b == NULL)
+    {
+      if (operation == SET_UNION)
+	{
+	  return a != NULL ? a : b;
+	}
+      if (operation == SET_INTERSECTION)
+	{
+	  spillTree(a, spare);
+	  spillTree(b, spare);
+	  return NULL;
+	}
+      spillTree(b, spare); // difference: nothing left to take away
+      return a;
+    }
+
+  // for a difference, split a around b's root; otherwise split b around a's
+  Node* pivot = a;
+  Node* other = b;
+  if (operation == SET_DIFFERENCE)
+    {
+      pivot = b;
+      other = a;
+    }
+  Node* pivotLeft = pivot->getLeft();
+  Node* pivotRight = pivot->getRight();
+  Node* otherLeft = NULL;
+  Node* otherRight = NULL;
+  Node* found = NULL;
+  split(other, pivot->getValue(), otherLeft, otherRight, found);
+
+  // the halves, in (a, b) order
+  Node* leftA = pivotLeft;
+  Node* leftB = otherLeft;
+  Node* rightA = pivotRight;
+  Node* rightB = otherRight;
+  if (operation == SET_DIFFERENCE)
+    {
+      leftA = otherLeft;
+      leftB = pivotLeft;
+      rightA = otherRight;
+      rightB = pivotRight;
+    }
+
+  Node* leftResult = NULL;
+  Node* rightResult = NULL;
+  if (threads > 1)
+    {
+      Node* leftSpare = NULL;
+      thread worker(setOperationThread, operation, leftA, leftB,
+		    threads / 2, &leftResult, &leftSpare);
+      rightResult = setOperation(operation, rightA, rightB,
+				 threads - threads / 2, spare);
+      worker.join();
+      // hook the other thread's spare nodes onto ours
+      if (leftSpare != NULL)
+	{
+	  Node* tail = leftSpare;
+	  while (tail->getLeft() != NULL)
+	    {
+	      tail = tail->getLeft();
+	    }
+	  tail->setLeft(spare);
+	  spare = leftSpare;
+	}
+    }
+  else
+    {
+      leftResult = setOperation(operation, leftA, leftB, 1, spare);
+      rightResult = setOperation(operation, rightA, rightB, 1, spare);
+    }
+
+  // decide which of pivot and found (if any) goes between the halves
+  Node* middle = NULL;
+  if (operation == SET_UNION)
+    {
+      middle = pivot;
+      if (found != NULL) // the same value was in both
+	{
+	  found->setLeft(spare);
+	  spare = found;
+	}
+    }
+  else if (operation == SET_INTERSECTION)
+    {
+      if (found != NULL) // keep one of the two copies
+	{
+	  middle = pivot;
+	  found->setLeft(spare);
+	  spare = found;
+	}
+      else
+	{
+	  pivot->setLeft(spare);
+	  spare = pivot;
+	}
+    }
+  else // difference: b's root never stays, and neither does its copy in a
+    {
+      pivot->setLeft(spare);
+      spare = pivot;
+      if (found != NULL)
+	{
+	  found->setLeft(spare);
+	  spare = found;
+	}
+    }
+
+  if (middle == NULL)
+    {
+      return joinTwo(leftResult, rightResult);
+    }
+  return join(leftResult, middle, rightResult);
+}
+
+// gives every node on a spare list back to the pool
+static void returnSpare(Node* spare, NodePool &pool)
+{
+  while (spare != NULL)
+    {
+      Node* next = spare->getLeft();
+      pool.returnNode(spare);
+      spare = next;
+    }
+}
+
+/**
+ * This function puts the union of trees a and b into a, and leaves b
+ * empty. Values that were in both are only kept once; the extra nodes go
+ * back to the pool. Both trees have to come from pool. Up to threads
+ * threads are used.
+ */
+void unionTrees(Node* &a, Node* &b, int threads, NodePool &pool)
+{
+  Node* spare = NULL;
+  a = setOperation(SET_UNION, a, b, threads, spare);
+  b = NULL;
+  returnSpare(spare, pool);
+}
+
+/**
+ * This function leaves only the values that are in both a and b in a,
+ * and leaves b empty. Every other node goes back to the pool. Both trees
+ * have to come from pool.
+ */
+void intersectTrees(Node* &a, Node* &b, int threads, NodePool &pool)
+{
+  Node* spare = NULL;
+  a = setOperation(SET_INTERSECTION, a, b, threads, spare);
+  b = NULL;
+  returnSpare(spare, pool);
+}
+
+/**
+ * This function takes every value in b out of a, and leaves b empty. The
+ * nodes taken out (and all of b's nodes) go back to the pool. Both trees
+ * have to come from pool.
+ */
+void subtractTrees(Node* &a, Node* &b, int threads, NodePool &pool)
+{
+  Node* spare = NULL;
+  a = setOperation(SET_DIFFERENCE, a, b, threads, spare);
+  b = NULL;
+  returnSpare(spare, pool);
+}
+
+#ifdef RBTREE_MULTISET
+static int addCopies(Node* &root, int key, int copies, NodePool &pool);
+
+/**
+ * This function adds a value to a tree that is used as a multiset. If the
+ * value is already there its node's count goes up by one and nothing else
+ * changes (no new node, no rotations); otherwise a node is added like
+ * insert() does. Returns how many copies of the value there are now.
+ * Subtree sizes count nodes, so rankOf and selectKth see each value once.
+ */
+int insertCounted(Node* &root, int key, NodePool &pool)
+{
+  return addCopies(root, key, 1, pool);
+}
+
+/**
+ * This function adds copies more of a value to a multiset, in one walk
+ * down. Returns how many copies of the value there are now.
+ */
+static int addCopies(Node* &root, int key, int copies, NodePool &pool)
+{
+  Node* current = root;
+  Node* parent = NULL;
+  while (current != NULL)
+    {
+      if (key == current->getValue()) // a repeat; just count it
+	{
+	  current->setCount(current->getCount() + copies);
+	  return current->getCount();
+	}
+      parent = current;
+      if (key < current->getValue())
+	{
+	  current = current->getLeft();
+	}
+      else
+	{
+	  current = current->getRight();
+	}
+    }
+
+  Node* newnode = pool.getNode(key);
+  if (parent == NULL) // empty tree
+    {
+      root = newnode;
+    }
+  else
+    {
+      if (key < parent->getValue())
+	{
+	  parent->setLeft(newnode);
+	}
+      else
+	{
+	  parent->setRight(newnode);
+	}
+      newnode->setParent(parent);
+      adjustSizes(parent, 1);
+    }
+  newnode->setCount(copies);
+  fixInsert(root, newnode);
+  return copies;
+}
+
+/**
+ * This function is insertBatch for a multiset: every key is kept, and
+ * repeats (in the batch or of values already in the tree) raise counts
+ * instead of being skipped. The batch is sorted so each run of equal keys
+ * costs one walk down. Into an empty tree, the distinct keys are built
+ * all at once with buildSorted and the counts filled in afterwards.
+ *
+ * @param keys | the keys to insert; this array gets sorted
+ * @return how many keys were repeats (added to a count, not as a node)
+ */
+int insertBatchCounted(Node* &root, int* keys, int count, NodePool &pool)
+{
+  sort(keys, keys + count);
+
+  // squeeze each run of equal keys down to one key and its length
+  int* copies = new int[count];
+  int unique = 0;
+  for (int i = 0; i < count; i++)
+    {
+      if (unique > 0 && keys[i] == keys[unique - 1])
+	{
+	  copies[unique - 1]++;
+	}
+      else
+	{
+	  keys[unique] = keys[i];
+	  copies[unique] = 1;
+	  unique++;
+	}
+    }
+
+  int repeats = count - unique;
+  if (root == NULL)
+    {
+      int built = unique;
+      buildSorted(root, keys, built, pool);
+      int i = 0;
+      for (Node* current = treeBegin(root).getNode(); current != NULL;
+	   current = current->getNext())
+	{
+	  current->setCount(copies[i]);
+	  i++;
+	}
+    }
+  else
+    {
+      for (int i = 0; i < unique; i++)
+	{
+	  if (addCopies(root, keys[i], copies[i], pool) != copies[i])
+	    {
+	      repeats++; // it was already in the tree
+	    }
+	}
+    }
+  delete[] copies;
+  return repeats;
+}
+
+/**
+ * This function takes one copy of a value out of a multiset. The node
+ * only comes out of the tree when its last copy does. Returns how many
+ * copies are left, or -1 if the value wasn't there.
+ */
+int removeCounted(Node* &root, int key, NodePool &pool)
+{
+  Node* found = search(root, key);
+  if (found == NULL)
+    {
+      return -1;
+    }
+  if (found->getCount() > 1)
+    {
+      found->setCount(found->getCount() - 1);
+      return found->getCount();
+    }
+  remove(root, root, key, pool);
+  return 0;
+}
+
+// returns how many copies of a value a multiset holds (0 if none)
+int countOf(Node* root, int key)
+{
+  Node* found = search(root, key);
+  if (found == NULL)
+    {
+      return 0;
+    }
+  return found->getCount();
+}
+#endif
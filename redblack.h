@@ -0,0 +1,90 @@
+#ifndef REDBLACK_H
+#define REDBLACK_H
+#include <iostream>
+#include "node.h"
+#include "nodepool.h"
+#include "rbcore.h"
+
+/*
+ * These are the red-black tree operations. They work on a tree given by
+ * its root pointer, and take nodes from (and give them back to) a
+ * NodePool. The balancing itself (fixInsert, the rotations, fixRemove and
+ * deleteByCase) is in rbcore.h, shared with the other pointer-based trees.
+ */
+
+// RED BLACK TREE CONDITIONS
+/*
+ * Node is either red or black
+ * root is black
+ * all "leaves" (null children) are black
+ * every red node has 2 black children
+ * every path from root to leaf has the same number of black nodes
+ */
+
+// insertion
+bool insert(Node* &root, Node* current,  Node* newnode);
+
+// general operations
+void print(Node* current, int numTabs);
+Node* search(Node* current, int searchkey);
+int searchBatch(Node* root, int* keys, int count, Node** results);
+
+// what rbcore.h needs for Node: the rotations keep subtree sizes right
+// through updateNode, and TRACE records the node's value
+void updateNode(Node* node);
+int traceKey(Node* node);
+
+// order statistics (subtree sizes)
+int sizeOf(Node* node);
+void updateSize(Node* node);
+void adjustSizes(Node* node, int change);
+int rankOf(Node* root, int key);
+Node* selectKth(Node* root, int k);
+
+// deletion
+void remove(Node* &root, Node* current, int searchkey, NodePool &pool);
+
+// insertion with a path stack (no parent lookups during the fix-up)
+bool insertWithPath(Node* &root, Node* newnode);
+
+// top-down (single pass) insertion and deletion
+bool insertTopDown(Node* &root, Node* newnode);
+bool removeTopDown(Node* &root, int key, NodePool &pool);
+
+// bulk loading
+bool isSorted(int* values, int count);
+int buildSorted(Node* &root, int* values, int &count, NodePool &pool);
+Node* buildSubtree(int* values, int start, int end, Node* parent,
+		   int depth, int redDepth, NodePool &pool);
+
+// parallel loading
+int sortUnique(int* values, int count, int threads);
+void buildParallel(Node* &root, int* values, int count, int threads,
+		   NodePool &pool);
+int loadUnsorted(Node* &root, int* values, int &count, int threads,
+		 NodePool &pool);
+
+// batch inserting
+int insertBatch(Node* &root, int* keys, int count, NodePool &pool);
+int mergeBatch(Node* &root, int* keys, int count, NodePool &pool);
+
+// joining and splitting
+int blackHeight(Node* root);
+Node* join(Node* left, Node* middle, Node* right);
+Node* joinTwo(Node* left, Node* right);
+void split(Node* root, int key, Node* &left, Node* &right, Node* &found);
+
+// set operations (built on join and split)
+void unionTrees(Node* &a, Node* &b, int threads, NodePool &pool);
+void intersectTrees(Node* &a, Node* &b, int threads, NodePool &pool);
+void subtractTrees(Node* &a, Node* &b, int threads, NodePool &pool);
+
+// multisets (repeats of a value are counted on its node); compile with
+// -DRBTREE_MULTISET to get these and the count in each Node
+#ifdef RBTREE_MULTISET
+int insertCounted(Node* &root, int key, NodePool &pool);
+int insertBatchCounted(Node* &root, int* keys, int count, NodePool &pool);
+int removeCounted(Node* &root, int key, NodePool &pool);
+int countOf(Node* root, int key);
+#endif
+#endif
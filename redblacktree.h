@@ -0,0 +1,524 @@
+#ifndef REDBLACKTREE_H
+#define REDBLACKTREE_H
+#include <iostream>
+#include <functional>
+#include <memory>
+#include <utility>
+#include "rbcore.h"
+
+/*
+ * RedBlackTree is a generic version of the int-only tree in redblack.cpp. Each
+ * node holds a key and a value, keys are ordered by Compare, and nodes are
+ * allocated through Alloc. The balancing is the same code the int tree
+ * runs: fixInsert(), the rotations and unlinkNode() from rbcore.h.
+ *
+ * Compare is a template parameter instead of a function pointer, so the
+ * compiler sees the comparison at compile time and inlines it. For int keys
+ * the default std::less<int> becomes a single compare instruction, just
+ * like the hard-coded < in redblack.cpp.
+ */
+template <class Key, class Value, class Compare = std::less<Key>,
+	  class Alloc = std::allocator<std::pair<const Key, Value> > >
+class RedBlackTree
+{
+ public:
+  struct TreeNode
+  {
+    std::pair<const Key, Value> item; // the key and its value
+    TreeNode* left;
+    TreeNode* right;
+    TreeNode* parent;
+    char color; // 'r' or 'b'
+
+    TreeNode(const Key& key, const Value& value)
+      : item(key, value), left(NULL), right(NULL), parent(NULL), color('r')
+    {
+    }
+
+    // the getters and setters rbcore.h uses
+    TreeNode* getLeft()
+    {
+      return left;
+    }
+
+    TreeNode* getRight()
+    {
+      return right;
+    }
+
+    TreeNode* getParent()
+    {
+      return parent;
+    }
+
+    char getColor()
+    {
+      return color;
+    }
+
+    void setLeft(TreeNode* newleft)
+    {
+      left = newleft;
+    }
+
+    void setRight(TreeNode* newright)
+    {
+      right = newright;
+    }
+
+    void setParent(TreeNode* newparent)
+    {
+      parent = newparent;
+    }
+
+    void setColor(char newcolor)
+    {
+      color = newcolor;
+    }
+
+    // a node keeps nothing about its subtree, so a rotation has nothing to
+    // work out again, and a key isn't always an int, so TRACE records 0
+    friend void updateNode(TreeNode*)
+    {
+    }
+
+    friend int traceKey(TreeNode*)
+    {
+      return 0;
+    }
+  };
+
+  /*
+   * An iterator walks the tree in key order using the parent pointers.
+   * It can go backwards, and stepping back from end() gives the largest
+   * node.
+   */
+  class iterator
+  {
+  public:
+    iterator() : tree(NULL), current(NULL)
+    {
+    }
+
+    iterator(RedBlackTree* newtree, TreeNode* newcurrent)
+      : tree(newtree), current(newcurrent)
+    {
+    }
+
+    std::pair<const Key, Value>& operator*()
+    {
+      return current->item;
+    }
+
+    std::pair<const Key, Value>* operator->()
+    {
+      return &current->item;
+    }
+
+    iterator& operator++()
+    {
+      current = RedBlackTree::nextNode(current);
+      return *this;
+    }
+
+    iterator& operator--()
+    {
+      if (current == NULL) // step back from the end
+	{
+	  current = tree->lastNode();
+	}
+      else
+	{
+	  current = RedBlackTree::previousNode(current);
+	}
+      return *this;
+    }
+
+    bool operator==(const iterator& other) const
+    {
+      return current == other.current;
+    }
+
+    bool operator!=(const iterator& other) const
+    {
+      return current != other.current;
+    }
+
+  private:
+    friend class RedBlackTree;
+    RedBlackTree* tree;
+    TreeNode* current;
+  };
+
+  // constructors and destructors
+  RedBlackTree()
+    : root(NULL), size(0), compare(Compare()), alloc(NodeAlloc())
+  {
+  }
+
+  RedBlackTree(const Compare& newCompare, const Alloc& newAlloc = Alloc())
+    : root(NULL), size(0), compare(newCompare), alloc(newAlloc)
+  {
+  }
+
+  ~RedBlackTree()
+  {
+    clear();
+  }
+
+  /**
+   * This function adds a key and its value. If the key is already in the
+   * tree, nothing changes and false is returned.
+   */
+  bool insert(const Key& key, const Value& value)
+  {
+    TreeNode* parent = NULL;
+    TreeNode* current = root;
+    while (current != NULL)
+      {
+	parent = current;
+	if (compare(key, current->item.first))
+	  {
+	    current = current->left;
+	  }
+	else if (compare(current->item.first, key))
+	  {
+	    current = current->right;
+	  }
+	else // we cannot have two nodes with the same key
+	  {
+	    return false;
+	  }
+      }
+
+    TreeNode* newnode = newNode(key, value);
+    newnode->parent = parent;
+    if (parent == NULL) // empty tree
+      {
+	root = newnode;
+      }
+    else if (compare(key, parent->item.first))
+      {
+	parent->left = newnode;
+      }
+    else
+      {
+	parent->right = newnode;
+      }
+    fixInsert(root, newnode);
+    return true;
+  }
+
+  /**
+   * This function removes a key. If the node has two children, the next
+   * largest node is unlinked instead and then moved into its place, so
+   * iterators at other keys stay good. Returns false if the key isn't in
+   * the tree.
+   */
+  bool remove(const Key& key)
+  {
+    TreeNode* current = findNode(key);
+    if (current == NULL)
+      {
+	return false;
+      }
+
+    if (current->left == NULL || current->right == NULL)
+      {
+	unlinkNode(root, current);
+	deleteNode(current);
+	return true;
+      }
+
+    // two children: the next largest node has at most one, so it can come
+    // out the simple way and then take over current's links and color
+    TreeNode* moved = current->right;
+    while (moved->left != NULL)
+      {
+	moved = moved->left;
+      }
+    unlinkNode(root, moved);
+
+    moved->parent = current->parent;
+    if (current->parent == NULL)
+      {
+	root = moved;
+      }
+    else if (current->parent->left == current)
+      {
+	current->parent->left = moved;
+      }
+    else
+      {
+	current->parent->right = moved;
+      }
+    moved->left = current->left;
+    moved->right = current->right;
+    if (moved->left != NULL)
+      {
+	moved->left->parent = moved;
+      }
+    if (moved->right != NULL)
+      {
+	moved->right->parent = moved;
+      }
+    moved->color = current->color;
+    deleteNode(current);
+    return true;
+  }
+
+  // returns a pointer to the key's value, or NULL if it isn't in the tree
+  Value* find(const Key& key)
+  {
+    TreeNode* found = findNode(key);
+    if (found == NULL)
+      {
+	return NULL;
+      }
+    return &found->item.second;
+  }
+
+  // returns whether the key is in the tree
+  bool contains(const Key& key)
+  {
+    return findNode(key) != NULL;
+  }
+
+  // returns an iterator at the smallest key
+  iterator begin()
+  {
+    TreeNode* current = root;
+    while (current != NULL && current->left != NULL)
+      {
+	current = current->left;
+      }
+    return iterator(this, current);
+  }
+
+  // returns the iterator one past the largest key
+  iterator end()
+  {
+    return iterator(this, NULL);
+  }
+
+  // returns an iterator at the first key that is not less than key
+  iterator lowerBound(const Key& key)
+  {
+    TreeNode* current = root;
+    TreeNode* best = NULL;
+    while (current != NULL)
+      {
+	if (!compare(current->item.first, key)) // current >= key
+	  {
+	    best = current;
+	    current = current->left;
+	  }
+	else
+	  {
+	    current = current->right;
+	  }
+      }
+    return iterator(this, best);
+  }
+
+  // returns an iterator at the first key that is greater than key
+  iterator upperBound(const Key& key)
+  {
+    TreeNode* current = root;
+    TreeNode* best = NULL;
+    while (current != NULL)
+      {
+	if (compare(key, current->item.first)) // current > key
+	  {
+	    best = current;
+	    current = current->left;
+	  }
+	else
+	  {
+	    current = current->right;
+	  }
+      }
+    return iterator(this, best);
+  }
+
+  /**
+   * This function calls visit(key, value) on every key with
+   * low <= key < high, in order, and returns how many were visited.
+   * It costs O(log n + k) for k keys.
+   */
+  template <class Visitor>
+  int visitRange(const Key& low, const Key& high, Visitor visit)
+  {
+    int visited = 0;
+    TreeNode* current = lowerBound(low).current;
+    while (current != NULL && compare(current->item.first, high))
+      {
+	visit(current->item.first, current->item.second);
+	visited++;
+	current = nextNode(current);
+      }
+    return visited;
+  }
+
+  // removes every node
+  void clear()
+  {
+    clear(root);
+    root = NULL;
+    size = 0;
+  }
+
+  // displays the tree sideways, like print() in redblack.cpp
+  void print()
+  {
+    print(root, 0);
+  }
+
+  // functions (getters)
+  TreeNode* getRoot()
+  {
+    return root;
+  }
+
+  int getSize()
+  {
+    return size;
+  }
+
+ private:
+  typedef typename std::allocator_traits<Alloc>::template
+    rebind_alloc<TreeNode> NodeAlloc;
+  typedef std::allocator_traits<NodeAlloc> NodeTraits;
+
+  // returns the next largest node, or NULL after the largest
+  static TreeNode* nextNode(TreeNode* current)
+  {
+    if (current->right != NULL)
+      {
+	current = current->right;
+	while (current->left != NULL)
+	  {
+	    current = current->left;
+	  }
+	return current;
+      }
+    TreeNode* parent = current->parent;
+    while (parent != NULL && current == parent->right)
+      {
+	current = parent;
+	parent = parent->parent;
+      }
+    return parent;
+  }
+
+  // returns the next smallest node, or NULL before the smallest
+  static TreeNode* previousNode(TreeNode* current)
+  {
+    if (current->left != NULL)
+      {
+	current = current->left;
+	while (current->right != NULL)
+	  {
+	    current = current->right;
+	  }
+	return current;
+      }
+    TreeNode* parent = current->parent;
+    while (parent != NULL && current == parent->left)
+      {
+	current = parent;
+	parent = parent->parent;
+      }
+    return parent;
+  }
+
+  // returns the node with the largest key
+  TreeNode* lastNode()
+  {
+    TreeNode* current = root;
+    while (current != NULL && current->right != NULL)
+      {
+	current = current->right;
+      }
+    return current;
+  }
+
+  // walks down the tree to the node holding the key
+  TreeNode* findNode(const Key& key)
+  {
+    TreeNode* current = root;
+    while (current != NULL)
+      {
+	if (compare(key, current->item.first))
+	  {
+	    current = current->left;
+	  }
+	else if (compare(current->item.first, key))
+	  {
+	    current = current->right;
+	  }
+	else
+	  {
+	    return current;
+	  }
+      }
+    return NULL;
+  }
+
+  // allocates and constructs a node through the allocator
+  TreeNode* newNode(const Key& key, const Value& value)
+  {
+    TreeNode* node = NodeTraits::allocate(alloc, 1);
+    NodeTraits::construct(alloc, node, key, value);
+    size++;
+    return node;
+  }
+
+  // destroys and frees a node through the allocator
+  void deleteNode(TreeNode* node)
+  {
+    NodeTraits::destroy(alloc, node);
+    NodeTraits::deallocate(alloc, node, 1);
+    size--;
+  }
+
+  void clear(TreeNode* current)
+  {
+    if (current == NULL)
+      {
+	return;
+      }
+    clear(current->left);
+    clear(current->right);
+    deleteNode(current);
+  }
+
+  void print(TreeNode* current, int numTabs)
+  {
+    if (current == NULL)
+      {
+	return;
+      }
+    numTabs += 1;
+    print(current->right, numTabs);
+    std::cout << std::endl;
+    for (int i = 1; i < numTabs; i++)
+      {
+	std::cout << "\t";
+      }
+    std::cout << current->item.first << " (" << current->color << ") "
+	      << "\n";
+    print(current->left, numTabs);
+  }
+
+  // the tree can't be copied; it owns its nodes
+  RedBlackTree(const RedBlackTree&);
+  RedBlackTree& operator=(const RedBlackTree&);
+
+  // variables
+  TreeNode* root;
+  int size;
+  Compare compare;
+  NodeAlloc alloc;
+};
+#endif
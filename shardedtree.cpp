@@ -0,0 +1,266 @@
+#include <iostream>
+#include <thread>
+#include <stdint.h>
+#include "shardedtree.h"
+#include "redblack.h"
+
+using namespace std;
+
+// constructor, which makes shardCount empty trees
+ShardedTree::ShardedTree(int newShardCount)
+{
+  shardCount = newShardCount;
+  if (shardCount < 1)
+    {
+      shardCount = 1;
+    }
+  shards = new Shard[shardCount];
+  for (int i = 0; i < shardCount; i++)
+    {
+      shards[i].root = NULL;
+      shards[i].size = 0;
+    }
+}
+
+// destructor; each shard's pool gives its nodes back
+ShardedTree::~ShardedTree()
+{
+  delete[] shards;
+}
+
+// adds a value to its shard; returns false if it was already there
+bool ShardedTree::insert(int key)
+{
+  Shard& shard = shards[getShardFor(key)];
+  lock_guard<mutex> guard(shard.lock);
+  Node* newnode = shard.pool.getNode(key);
+  if (!::insert(shard.root, shard.root, newnode))
+    {
+      shard.pool.returnNode(newnode);
+      return false;
+    }
+  shard.size++;
+  return true;
+}
+
+// removes a value from its shard; returns false if it wasn't there
+bool ShardedTree::remove(int key)
+{
+  Shard& shard = shards[getShardFor(key)];
+  lock_guard<mutex> guard(shard.lock);
+  if (::search(shard.root, key) == NULL)
+    {
+      return false;
+    }
+  ::remove(shard.root, shard.root, key, shard.pool);
+  shard.size--;
+  return true;
+}
+
+// returns whether the value is in its shard
+bool ShardedTree::search(int key)
+{
+  Shard& shard = shards[getShardFor(key)];
+  lock_guard<mutex> guard(shard.lock);
+  return ::search(shard.root, key) != NULL;
+}
+
+/**
+ * This function adds a batch of keys using several threads. The keys are
+ * first split up by shard, then each thread takes every threads-th shard
+ * and hands it its part of the batch with insertBatch() from redblack.h.
+ * Returns how many keys were skipped because they were already there (or
+ * repeated in the batch).
+ *
+ * @param threads | how many threads to use, counting this one
+ */
+int ShardedTree::insertBatch(int* keys, int count, int threads)
+{
+  // count how many keys go to each shard, then copy them over
+  int* bucketSizes = new int[shardCount];
+  for (int i = 0; i < shardCount; i++)
+    {
+      bucketSizes[i] = 0;
+    }
+  for (int i = 0; i < count; i++)
+    {
+      bucketSizes[getShardFor(keys[i])]++;
+    }
+  int** buckets = new int*[shardCount];
+  int* filled = new int[shardCount];
+  for (int i = 0; i < shardCount; i++)
+    {
+      buckets[i] = new int[bucketSizes[i]];
+      filled[i] = 0;
+    }
+  for (int i = 0; i < count; i++)
+    {
+      int shard = getShardFor(keys[i]);
+      buckets[shard][filled[shard]] = keys[i];
+      filled[shard]++;
+    }
+
+  if (threads < 1)
+    {
+      threads = 1;
+    }
+  if (threads > shardCount) // more threads than shards would sit idle
+    {
+      threads = shardCount;
+    }
+  int* skipped = new int[shardCount];
+  thread* workers = new thread[threads - 1];
+  for (int t = 1; t < threads; t++)
+    {
+      workers[t - 1] = thread(insertShards, this, t, threads, buckets,
+			      bucketSizes, skipped);
+    }
+  insertShards(this, 0, threads, buckets, bucketSizes, skipped);
+  for (int t = 1; t < threads; t++)
+    {
+      workers[t - 1].join();
+    }
+
+  int totalSkipped = 0;
+  for (int i = 0; i < shardCount; i++)
+    {
+      totalSkipped += skipped[i];
+      delete[] buckets[i];
+    }
+  delete[] workers;
+  delete[] skipped;
+  delete[] filled;
+  delete[] buckets;
+  delete[] bucketSizes;
+  return totalSkipped;
+}
+
+/**
+ * This function is what each insertBatch thread runs: it inserts the
+ * buckets for shards first, first + step, first + 2 * step, ...
+ */
+void ShardedTree::insertShards(ShardedTree* tree, int first, int step,
+			       int** buckets, int* bucketSizes, int* skipped)
+{
+  for (int i = first; i < tree->shardCount; i += step)
+    {
+      skipped[i] = 0;
+      if (bucketSizes[i] == 0)
+	{
+	  continue;
+	}
+      Shard& shard = tree->shards[i];
+      lock_guard<mutex> guard(shard.lock);
+      skipped[i] = ::insertBatch(shard.root, buckets[i], bucketSizes[i],
+				 shard.pool);
+      shard.size += bucketSizes[i] - skipped[i];
+    }
+}
+
+// removes every value from every shard
+void ShardedTree::clear()
+{
+  for (int i = 0; i < shardCount; i++)
+    {
+      lock_guard<mutex> guard(shards[i].lock);
+      shards[i].pool.clear();
+      shards[i].root = NULL;
+      shards[i].size = 0;
+    }
+}
+
+// returns how many shards there are
+int ShardedTree::getShardCount()
+{
+  return shardCount;
+}
+
+// returns which shard a value belongs to; the value is hashed first so
+// runs of nearby values get spread over all the shards
+int ShardedTree::getShardFor(int key)
+{
+  uint32_t hash = (uint32_t)key * 2654435761u;
+  return (int)(((uint64_t)hash * shardCount) >> 32);
+}
+
+// returns the number of values in all shards
+int ShardedTree::getSize()
+{
+  int total = 0;
+  for (int i = 0; i < shardCount; i++)
+    {
+      total += shards[i].size;
+    }
+  return total;
+}
+
+// returns the number of values in one shard
+int ShardedTree::getShardSize(int shard)
+{
+  return shards[shard].size;
+}
+
+// returns the root of one shard's tree
+Node* ShardedTree::getShardRoot(int shard)
+{
+  return shards[shard].root;
+}
+
+// constructor, which starts at the smallest value in any shard
+ShardIterator::ShardIterator(ShardedTree* tree)
+{
+  shardCount = tree->getShardCount();
+  positions = new TreeIterator[shardCount];
+  for (int i = 0; i < shardCount; i++)
+    {
+      positions[i] = treeBegin(tree->getShardRoot(i));
+    }
+  findSmallest();
+}
+
+// destructor
+ShardIterator::~ShardIterator()
+{
+  delete[] positions;
+}
+
+// returns the current value
+int ShardIterator::operator*()
+{
+  return *positions[current];
+}
+
+// moves the shard we just used forward, then finds the new smallest
+ShardIterator& ShardIterator::operator++()
+{
+  if (current != -1)
+    {
+      ++positions[current];
+      findSmallest();
+    }
+  return *this;
+}
+
+// returns whether every value has been visited
+bool ShardIterator::atEnd()
+{
+  return current == -1;
+}
+
+// looks at the next value in each shard and picks the smallest; there are
+// only as many shards as cores, so a plain loop is quicker than a heap
+void ShardIterator::findSmallest()
+{
+  current = -1;
+  for (int i = 0; i < shardCount; i++)
+    {
+      if (positions[i].getNode() == NULL)
+	{
+	  continue;
+	}
+      if (current == -1 || *positions[i] < *positions[current])
+	{
+	  current = i;
+	}
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef SHARDEDTREE_H
+#define SHARDEDTREE_H
+#include <iostream>
+#include <mutex>
+#include "node.h"
+#include "nodepool.h"
+#include "treeiterator.h"
+
+/*
+ * A ShardedTree spreads its values over several independent red-black
+ * trees ("shards"), so threads working on different shards don't get in
+ * each other's way. Each value always goes to the same shard, picked by
+ * hashing it, and each shard has its own root, pool and lock. The shards
+ * use the normal tree functions from redblack.h.
+ *
+ * insert, remove and search can be called from any number of threads.
+ * Walking the values in order (with a ShardIterator) and clear() should
+ * only happen while no other thread is using the tree.
+ */
+class ShardedTree
+{
+ public:
+  // constructors and destructors
+  ShardedTree(int shardCount);
+  ~ShardedTree();
+
+  // functions
+  bool insert(int); // returns false if the value is already there
+  bool remove(int); // returns false if the value wasn't there
+  bool search(int); // returns whether the value is there
+  int insertBatch(int* keys, int count, int threads);
+  void clear(); // removes every value
+
+  // functions (getters)
+  int getShardCount();
+  int getShardFor(int key); // returns which shard a value lives in
+  int getSize(); // returns the number of values in all shards
+  int getShardSize(int shard);
+  Node* getShardRoot(int shard);
+
+ private:
+  // one independent tree, on its own cache lines
+  struct alignas(64) Shard
+  {
+    Node* root;
+    NodePool pool;
+    std::mutex lock;
+    int size;
+  };
+
+  // functions
+  static void insertShards(ShardedTree* tree, int first, int step,
+			   int** buckets, int* bucketSizes, int* skipped);
+
+  // variables
+  Shard* shards;
+  int shardCount;
+
+  // not copyable
+  ShardedTree(const ShardedTree&);
+  ShardedTree& operator=(const ShardedTree&);
+};
+
+/*
+ * A ShardIterator walks every value in a ShardedTree from smallest to
+ * largest. It keeps a TreeIterator in each shard and always steps the one
+ * holding the smallest value, like merging sorted lists.
+ */
+class ShardIterator
+{
+ public:
+  // constructors and destructors
+  ShardIterator(ShardedTree* tree); // starts at the smallest value
+  ~ShardIterator();
+
+  // functions
+  int operator*(); // returns the current value
+  ShardIterator& operator++(); // moves to the next largest value
+  bool atEnd(); // returns whether every value has been visited
+
+ private:
+  // functions
+  void findSmallest(); // points current at the shard with the smallest value
+
+  // variables
+  TreeIterator* positions; // where each shard is up to
+  int shardCount;
+  int current; // the shard holding the current value, or -1 at the end
+
+  // not copyable
+  ShardIterator(const ShardIterator&);
+  ShardIterator& operator=(const ShardIterator&);
+};
+#endif
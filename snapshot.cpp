@@ -0,0 +1,351 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <climits>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+using namespace std;
+
+// flag bits stored for each node
+static const unsigned char SNAPSHOT_BLACK = 1;
+static const unsigned char SNAPSHOT_LEFT = 2;
+static const unsigned char SNAPSHOT_RIGHT = 4;
+static const unsigned char SNAPSHOT_COUNTED = 8;
+static const unsigned char SNAPSHOT_FLAGS = 15; // every bit above
+
+// a red-black tree with 2^32 nodes is at most 64 levels tall
+static const int MAX_HEIGHT = 128;
+
+// the size of the "RBT1" tag plus the node count
+static const size_t HEADER_SIZE = 8;
+
+/**
+ * This function writes the tree to a snapshot file. The tree is walked
+ * in pre-order three times: once to write the values, once for the flags
+ * and once for the counts of repeated values (in a multiset).
+ *
+ * @param root | the tree to save (an empty tree gives an empty snapshot)
+ */
+bool saveSnapshot(Node* root, const char* filename)
+{
+  ofstream outFile(filename, ios::out | ios::binary | ios::trunc);
+  if (!outFile)
+    {
+      return false;
+    }
+
+  // the count is filled in once the values have been written, since the
+  // sizes aren't kept up to date when order statistics are compiled out
+  uint32_t count = 0;
+  outFile.write("RBT1", 4);
+  outFile.write((const char*)&count, sizeof(count));
+
+  for (int pass = 0; pass < 3; pass++)
+    {
+      // pre-order walk with a stack of right children still to visit
+      Node* stack[MAX_HEIGHT];
+      int stackSize = 0;
+      Node* current = root;
+      while (current != NULL)
+	{
+	  if (pass == 0) // values
+	    {
+	      int32_t value = current->getValue();
+	      outFile.write((const char*)&value, sizeof(value));
+	      count++;
+	    }
+	  else if (pass == 2) // counts
+	    {
+	      if (current->getCount() > 1)
+		{
+		  uint32_t copies = current->getCount();
+		  outFile.write((const char*)&copies, sizeof(copies));
+		}
+	    }
+	  else // flags
+	    {
+	      unsigned char flags = 0;
+	      if (current->getColor() == 'b')
+		{
+		  flags |= SNAPSHOT_BLACK;
+		}
+	      if (current->getLeft() != NULL)
+		{
+		  flags |= SNAPSHOT_LEFT;
+		}
+	      if (current->getRight() != NULL)
+		{
+		  flags |= SNAPSHOT_RIGHT;
+		}
+	      if (current->getCount() > 1)
+		{
+		  flags |= SNAPSHOT_COUNTED;
+		}
+	      outFile.put(flags);
+	    }
+
+	  // go left next, and come back for the right child later
+	  if (current->getRight() != NULL)
+	    {
+	      stack[stackSize] = current->getRight();
+	      stackSize++;
+	    }
+	  if (current->getLeft() != NULL)
+	    {
+	      current = current->getLeft();
+	    }
+	  else if (stackSize > 0)
+	    {
+	      stackSize--;
+	      current = stack[stackSize];
+	    }
+	  else
+	    {
+	      current = NULL;
+	    }
+	}
+    }
+  outFile.seekp(4);
+  outFile.write((const char*)&count, sizeof(count));
+  return outFile.good();
+}
+
+/**
+ * This function checks that a decoded snapshot is really a red-black tree:
+ * the values go up in order, the root is black, no red node has a red
+ * child, and every path down has the same number of black nodes. A
+ * flipped value or color bit in the file shows up here. The black
+ * heights are worked out in each node's size field (going backwards
+ * through the pre-order, so children are done before parents); the
+ * caller fills in the real sizes afterwards. It is O(n).
+ *
+ * @param order | the nodes in pre-order
+ */
+static bool checkTree(Node* root, Node** order, uint32_t count)
+{
+  if (root == NULL)
+    {
+      return true;
+    }
+  if (root->getColor() != 'b')
+    {
+      return false;
+    }
+  for (uint32_t i = count; i > 0; i--)
+    {
+      Node* node = order[i - 1];
+      Node* children[2] = { node->getLeft(), node->getRight() };
+      int heights[2] = { 1, 1 }; // a NULL child counts as one black node
+      for (int j = 0; j < 2; j++)
+	{
+	  if (children[j] != NULL)
+	    {
+	      if (node->getColor() == 'r' && children[j]->getColor() == 'r')
+		{
+		  return false;
+		}
+	      heights[j] = children[j]->getSize();
+	    }
+	}
+      if (heights[0] != heights[1])
+	{
+	  return false;
+	}
+      node->setSize(heights[0] + (node->getColor() == 'b' ? 1 : 0));
+    }
+
+  // an in-order walk has to see every value bigger than the one before
+  Node* current = root;
+  while (current->getLeft() != NULL)
+    {
+      current = current->getLeft();
+    }
+  for (Node* next = current->getNext(); next != NULL;
+       next = next->getNext())
+    {
+      if (next->getValue() <= current->getValue())
+	{
+	  return false;
+	}
+      current = next;
+    }
+  return true;
+}
+
+/**
+ * This function replaces the tree with the one in a snapshot file. The
+ * file is memory-mapped and the nodes are rebuilt in the order they were
+ * saved: each node is the left child of the one before it if that node
+ * has a left child, and otherwise it is the right child of the most recent
+ * node still waiting for one. Subtree sizes are filled in afterwards by
+ * going through the nodes backwards, so children are done before parents.
+ * Returns false (and leaves the tree alone) if the file is not a snapshot,
+ * or if what it holds isn't a valid red-black tree (see checkTree).
+ *
+ * @param root | set to the root of the loaded tree
+ * @param pool | where the new nodes come from
+ */
+bool loadSnapshot(Node* &root, const char* filename, NodePool &pool)
+{
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    {
+      return false;
+    }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < HEADER_SIZE)
+    {
+      close(fd);
+      return false;
+    }
+  void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping stays valid after the file is closed
+  if (data == MAP_FAILED)
+    {
+      return false;
+    }
+  const char* bytes = (const char*)data;
+
+  // check the tag and that the file is exactly the right length
+  uint32_t count = 0;
+  memcpy(&count, bytes + 4, sizeof(count));
+  if (memcmp(bytes, "RBT1", 4) != 0 ||
+      (size_t)info.st_size < HEADER_SIZE + (size_t)count * 5)
+    {
+      munmap(data, info.st_size);
+      return false;
+    }
+  const int32_t* values = (const int32_t*)(bytes + HEADER_SIZE);
+  const unsigned char* flags = (const unsigned char*)(values + count);
+  const char* counts = (const char*)(flags + count); // repeated values only
+  size_t counted = 0;
+  for (uint32_t i = 0; i < count; i++)
+    {
+      if (flags[i] & SNAPSHOT_COUNTED)
+	{
+	  counted++;
+	}
+    }
+#ifndef RBTREE_MULTISET
+  if (counted > 0) // the counts would be lost, so don't load it at all
+    {
+      munmap(data, info.st_size);
+      return false;
+    }
+#endif
+  if ((size_t)info.st_size != HEADER_SIZE + (size_t)count * 5 + counted * 4)
+    {
+      munmap(data, info.st_size);
+      return false;
+    }
+
+  Node** order = new Node*[count]; // the nodes in pre-order
+  Node* stack[MAX_HEIGHT]; // nodes still waiting for a right child
+  int stackSize = 0;
+  Node* newroot = NULL;
+  bool valid = true;
+
+  uint32_t made = 0; // how many nodes have been taken from the pool
+  for (uint32_t i = 0; i < count && valid; i++)
+    {
+      Node* node = pool.getNode(values[i]);
+      order[i] = node;
+      made++;
+      if (flags[i] & ~SNAPSHOT_FLAGS)
+	{
+	  valid = false; // a bit no version of the format writes
+	}
+      if (flags[i] & SNAPSHOT_BLACK)
+	{
+	  node->setColor('b');
+	}
+      if (flags[i] & SNAPSHOT_COUNTED)
+	{
+	  uint32_t copies = 0;
+	  memcpy(&copies, counts, sizeof(copies));
+	  counts += sizeof(copies);
+	  if (copies < 2 || copies > INT_MAX) // only repeats get a count
+	    {
+	      valid = false;
+	    }
+	  node->setCount(copies);
+	}
+
+      if (i == 0)
+	{
+	  newroot = node;
+	}
+      else if (flags[i - 1] & SNAPSHOT_LEFT) // left child of the last node
+	{
+	  order[i - 1]->setLeft(node);
+	  node->setParent(order[i - 1]);
+	}
+      else if (stackSize > 0) // right child of the last node waiting
+	{
+	  stackSize--;
+	  stack[stackSize]->setRight(node);
+	  node->setParent(stack[stackSize]);
+	}
+      else
+	{
+	  valid = false; // the flags don't describe a tree
+	}
+
+      if (flags[i] & SNAPSHOT_RIGHT)
+	{
+	  if (stackSize == MAX_HEIGHT)
+	    {
+	      valid = false;
+	    }
+	  else
+	    {
+	      stack[stackSize] = node;
+	      stackSize++;
+	    }
+	}
+    }
+  if (count > 0 && (stackSize != 0 || (flags[count - 1] & SNAPSHOT_LEFT)))
+    {
+      valid = false; // some node never got its child
+    }
+  if (valid)
+    {
+      valid = checkTree(newroot, order, count);
+    }
+
+  if (!valid)
+    {
+      for (uint32_t i = 0; i < made; i++)
+	{
+	  pool.returnNode(order[i]);
+	}
+    }
+  else
+    {
+      // children come after their parent, so go backwards to fill in sizes
+      for (uint32_t i = count; i > 0; i--)
+	{
+	  Node* node = order[i - 1];
+	  int size = 1;
+	  if (node->getLeft() != NULL)
+	    {
+	      size += node->getLeft()->getSize();
+	    }
+	  if (node->getRight() != NULL)
+	    {
+	      size += node->getRight()->getSize();
+	    }
+	  node->setSize(size);
+	}
+      root = newroot;
+    }
+
+  delete[] order;
+  munmap(data, info.st_size);
+  return valid;
+}
@@ -0,0 +1,30 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <iostream>
+#include "node.h"
+#include "nodepool.h"
+
+/*
+ * A snapshot is a binary copy of the tree that can be loaded back without
+ * inserting anything. The file holds:
+ *
+ *   "RBT1"            4 bytes, to recognize the file
+ *   count             32-bit number of nodes
+ *   values[count]     32-bit values, in pre-order (node, left, right)
+ *   flags[count]      one byte per node, in the same order:
+ *                     1 = black, 2 = has a left child, 4 = has a right child,
+ *                     8 = the value is repeated (see insertCounted)
+ *   counts[]          32-bit count for each node with flag 8, in order
+ *                     (only loaded by builds with -DRBTREE_MULTISET)
+ *
+ * The pre-order plus the child flags is enough to put every node back in
+ * exactly the same spot with the same color, so loading does no
+ * rotations. Once the nodes are in place, one O(n) pass checks that the
+ * values are in order and the colors follow the red-black rules, so a
+ * damaged file is turned away instead of loading a broken tree.
+ */
+
+// functions
+bool saveSnapshot(Node* root, const char* filename);
+bool loadSnapshot(Node* &root, const char* filename, NodePool &pool);
+#endif
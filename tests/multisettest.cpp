@@ -0,0 +1,166 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <map>
+#include "../node.h"
+#include "../nodepool.h"
+#include "../redblack.h"
+#include "../filescanner.h"
+#include "../treeiterator.h"
+
+using namespace std;
+
+/*
+ * Description | Checks that loading a file with repeated values in
+ * multiset mode keeps every copy, the way the menu's 'read' command does
+ * it (FileScanner batches into insertBatchCounted), both into an empty
+ * tree and into one that already holds some of the values. Prints what
+ * went wrong and returns 1 on failure, 0 on success.
+ *
+ *   g++ -DRBTREE_MULTISET -pthread -o multisettest tests/multisettest.cpp
+ *       redblack.cpp node.cpp nodepool.cpp treeiterator.cpp trace.cpp
+ *       filescanner.cpp
+ */
+
+// FUNCTION PROTOTYPES
+bool loadFile(Node* &root, const char* filename, int batchSize,
+	      NodePool &pool);
+bool checkTree(Node* root, map<int, int> &expected);
+bool checkColors(Node* node, int &blackHeight);
+
+int main()
+{
+  const char* filename = "multisettest.txt";
+  map<int, int> expected; // value -> copies
+  ofstream outFile(filename);
+  unsigned int seed = 7;
+  for (int i = 0; i < 20000; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      int value = (int)((seed >> 8) % 500) - 250; // lots of repeats
+      outFile << value << (i % 10 == 9 ? '\n' : ' ');
+      expected[value]++;
+    }
+  outFile.close();
+
+  bool passed = true;
+
+  // into an empty tree, with batches small enough to hit the non-empty
+  // path too once the first batch is in
+  for (int batchSize = 100000; batchSize >= 64; batchSize /= 40)
+    {
+      Node* root = NULL;
+      NodePool pool;
+      if (!loadFile(root, filename, batchSize, pool) ||
+	  !checkTree(root, expected))
+	{
+	  cout << "loading in batches of " << batchSize << " failed" << endl;
+	  passed = false;
+	}
+
+      // loading the same file again doubles every count
+      map<int, int> doubled = expected;
+      for (map<int, int>::iterator it = doubled.begin(); it != doubled.end();
+	   ++it)
+	{
+	  it->second *= 2;
+	}
+      if (!loadFile(root, filename, batchSize, pool) ||
+	  !checkTree(root, doubled))
+	{
+	  cout << "loading twice in batches of " << batchSize << " failed"
+	       << endl;
+	  passed = false;
+	}
+    }
+
+  remove(filename);
+  if (passed)
+    {
+      cout << "multiset load: ok" << endl;
+    }
+  return passed ? 0 : 1;
+}
+
+// reads every value in a file into the tree, counting repeats
+bool loadFile(Node* &root, const char* filename, int batchSize,
+	      NodePool &pool)
+{
+  FileScanner scanner;
+  if (!scanner.open(filename))
+    {
+      return false;
+    }
+  int* batch = new int[batchSize];
+  int found = 0;
+  while ((found = scanner.next(batch, batchSize)) > 0)
+    {
+      insertBatchCounted(root, batch, found, pool);
+    }
+  delete[] batch;
+  scanner.close();
+  return true;
+}
+
+/**
+ * This function checks that the tree holds exactly the expected values
+ * with the expected counts, in order, and is still a red-black tree.
+ */
+bool checkTree(Node* root, map<int, int> &expected)
+{
+  map<int, int>::iterator wanted = expected.begin();
+  for (TreeIterator it = treeBegin(root); it != treeEnd(root); ++it)
+    {
+      if (wanted == expected.end() || *it != wanted->first ||
+	  it.getNode()->getCount() != wanted->second ||
+	  countOf(root, *it) != wanted->second)
+	{
+	  cout << "wrong value or count at " << *it << endl;
+	  return false;
+	}
+      ++wanted;
+    }
+  if (wanted != expected.end())
+    {
+      cout << "values are missing" << endl;
+      return false;
+    }
+  int blackHeight = 0;
+  if ((root != NULL && root->getColor() != 'b') ||
+      !checkColors(root, blackHeight))
+    {
+      cout << "not a valid red-black tree" << endl;
+      return false;
+    }
+  return true;
+}
+
+// checks for red nodes with red children and uneven black heights
+bool checkColors(Node* node, int &blackHeight)
+{
+  if (node == NULL)
+    {
+      blackHeight = 1;
+      return true;
+    }
+  int left = 0;
+  int right = 0;
+  if (!checkColors(node->getLeft(), left) ||
+      !checkColors(node->getRight(), right) || left != right)
+    {
+      return false;
+    }
+  if (node->getColor() == 'r')
+    {
+      Node* children[2] = { node->getLeft(), node->getRight() };
+      for (int i = 0; i < 2; i++)
+	{
+	  if (children[i] != NULL && children[i]->getColor() == 'r')
+	    {
+	      return false;
+	    }
+	}
+    }
+  blackHeight = left + (node->getColor() == 'b' ? 1 : 0);
+  return true;
+}
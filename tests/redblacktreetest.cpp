@@ -0,0 +1,238 @@
+#include <iostream>
+#include <string>
+#include <map>
+#include <functional>
+#include "../redblacktree.h"
+
+using namespace std;
+
+/*
+ * Description | Checks the generic RedBlackTree in redblacktree.h against
+ * std::map: random inserts and removes, finds, iterating both ways,
+ * lowerBound/upperBound and visitRange, with the red-black rules checked
+ * after every step. It is run once with the default std::less and once
+ * with std::greater, so Compare really decides the order. Prints what
+ * went wrong and returns 1 on failure, 0 on success.
+ *
+ *   g++ -o redblacktreetest tests/redblacktreetest.cpp
+ */
+
+// every member is compiled, not just the ones the test happens to call
+template class RedBlackTree<int, string>;
+template class RedBlackTree<int, string, greater<int> >;
+
+// FUNCTION PROTOTYPES
+template <class Compare>
+bool runTest(const char* name);
+template <class Tree, class Map>
+bool checkTree(Tree &tree, Map &expected);
+template <class TreeNode>
+bool checkColors(TreeNode* node, int &blackHeight);
+
+// adds up the keys visitRange hands it
+struct SumKeys
+{
+  long* sum;
+
+  void operator()(const int& key, string&)
+  {
+    *sum += key;
+  }
+};
+
+int main()
+{
+  bool passed = runTest<less<int> >("less");
+  passed = runTest<greater<int> >("greater") && passed;
+  if (passed)
+    {
+      cout << "generic tree: ok" << endl;
+    }
+  return passed ? 0 : 1;
+}
+
+/**
+ * This function runs random operations on a RedBlackTree and a std::map
+ * ordered by the same Compare and checks that they always agree.
+ */
+template <class Compare>
+bool runTest(const char* name)
+{
+  RedBlackTree<int, string, Compare> tree;
+  map<int, string, Compare> expected;
+  unsigned int seed = 11;
+  for (int step = 0; step < 4000; step++)
+    {
+      seed = seed * 1103515245 + 12345;
+      int key = (int)((seed >> 8) % 600) - 300;
+      string value = to_string(step);
+      bool insertIt = (seed >> 4) % 3 != 0; // the tree grows on average
+      bool changed = false;
+      bool wanted = false;
+      if (insertIt)
+	{
+	  changed = tree.insert(key, value);
+	  wanted = expected.insert(make_pair(key, value)).second;
+	}
+      else
+	{
+	  changed = tree.remove(key);
+	  wanted = expected.erase(key) == 1;
+	}
+      if (changed != wanted)
+	{
+	  cout << name << ": " << (insertIt ? "insert " : "remove ") << key
+	       << " returned " << changed << endl;
+	  return false;
+	}
+      if (step % 50 == 0 && !checkTree(tree, expected))
+	{
+	  cout << name << ": wrong after step " << step << endl;
+	  return false;
+	}
+    }
+  if (!checkTree(tree, expected))
+    {
+      cout << name << ": wrong at the end" << endl;
+      return false;
+    }
+
+  // bounds and ranges, including keys that aren't in the tree
+  for (int key = -310; key <= 310; key += 7)
+    {
+      typename RedBlackTree<int, string, Compare>::iterator lower =
+	tree.lowerBound(key);
+      typename RedBlackTree<int, string, Compare>::iterator upper =
+	tree.upperBound(key);
+      typename map<int, string, Compare>::iterator wantLower =
+	expected.lower_bound(key);
+      typename map<int, string, Compare>::iterator wantUpper =
+	expected.upper_bound(key);
+      if ((lower == tree.end()) != (wantLower == expected.end()) ||
+	  (lower != tree.end() && lower->first != wantLower->first) ||
+	  (upper == tree.end()) != (wantUpper == expected.end()) ||
+	  (upper != tree.end() && upper->first != wantUpper->first))
+	{
+	  cout << name << ": wrong bound for " << key << endl;
+	  return false;
+	}
+
+      int high = Compare()(0, 1) ? key + 40 : key - 40;
+      long sum = 0;
+      SumKeys visit = { &sum };
+      int visited = tree.visitRange(key, high, visit);
+      long wantSum = 0;
+      int wantVisited = 0;
+      for (typename map<int, string, Compare>::iterator it = wantLower;
+	   it != expected.lower_bound(high); ++it)
+	{
+	  wantSum += it->first;
+	  wantVisited++;
+	}
+      if (visited != wantVisited || sum != wantSum)
+	{
+	  cout << name << ": wrong range from " << key << endl;
+	  return false;
+	}
+    }
+
+  tree.clear();
+  if (tree.getSize() != 0 || tree.getRoot() != NULL ||
+      tree.begin() != tree.end())
+    {
+      cout << name << ": clear left nodes behind" << endl;
+      return false;
+    }
+  return true;
+}
+
+/**
+ * This function checks that the tree holds exactly the expected keys and
+ * values, forwards and backwards, and is still a red-black tree.
+ */
+template <class Tree, class Map>
+bool checkTree(Tree &tree, Map &expected)
+{
+  if (tree.getSize() != (int)expected.size())
+    {
+      cout << "size is " << tree.getSize() << ", not " << expected.size()
+	   << endl;
+      return false;
+    }
+  typename Map::iterator wanted = expected.begin();
+  for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it)
+    {
+      if (wanted == expected.end() || it->first != wanted->first ||
+	  it->second != wanted->second)
+	{
+	  cout << "wrong key or value at " << it->first << endl;
+	  return false;
+	}
+      string* found = tree.find(it->first);
+      if (found == NULL || *found != wanted->second)
+	{
+	  cout << "find missed " << it->first << endl;
+	  return false;
+	}
+      ++wanted;
+    }
+  if (wanted != expected.end())
+    {
+      cout << "keys are missing" << endl;
+      return false;
+    }
+
+  // walking back from end() visits the same keys in reverse
+  typename Map::reverse_iterator back = expected.rbegin();
+  typename Tree::iterator it = tree.end();
+  while (back != expected.rend())
+    {
+      --it;
+      if (it->first != back->first)
+	{
+	  cout << "stepping back gave " << it->first << endl;
+	  return false;
+	}
+      ++back;
+    }
+
+  int blackHeight = 0;
+  if ((tree.getRoot() != NULL && tree.getRoot()->color != 'b') ||
+      !checkColors(tree.getRoot(), blackHeight))
+    {
+      cout << "not a valid red-black tree" << endl;
+      return false;
+    }
+  return true;
+}
+
+// checks parent pointers, red nodes with red children and black heights
+template <class TreeNode>
+bool checkColors(TreeNode* node, int &blackHeight)
+{
+  if (node == NULL)
+    {
+      blackHeight = 1;
+      return true;
+    }
+  if ((node->left != NULL && node->left->parent != node) ||
+      (node->right != NULL && node->right->parent != node))
+    {
+      return false;
+    }
+  int left = 0;
+  int right = 0;
+  if (!checkColors(node->left, left) || !checkColors(node->right, right) ||
+      left != right)
+    {
+      return false;
+    }
+  if (node->color == 'r' &&
+      ((node->left != NULL && node->left->color == 'r') ||
+       (node->right != NULL && node->right->color == 'r')))
+    {
+      return false;
+    }
+  blackHeight = left + (node->color == 'b' ? 1 : 0);
+  return true;
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <mutex>
+#include "trace.h"
+
+using namespace std;
+
+// one saved event in the ring buffer
+struct TraceEntry
+{
+  TraceEvent event;
+  int value; // the node value the event happened at
+};
+
+// the counters and the ring buffer, shared by every thread that traces
+// (the sharded, parallel and set-operation workers do), so traceLock
+// guards all three
+static long counters[TRACE_EVENT_COUNT];
+static TraceEntry ring[TRACE_BUFFER_SIZE];
+static long recorded = 0; // total events ever recorded
+static mutex traceLock;
+
+// names for printing, in the same order as TraceEvent
+static const char* eventNames[TRACE_EVENT_COUNT] =
+  {
+    "insert case 1",
+    "insert case 2",
+    "insert case 3",
+    "insert case 4",
+    "insert case 5",
+    "insert duplicate",
+    "insert: no case matched",
+    "remove: no children",
+    "remove: one child",
+    "remove: two children",
+    "remove part i",
+    "remove part ii",
+    "remove part iii",
+    "delete case 1",
+    "delete case 2",
+    "delete case 3",
+    "delete case 4",
+    "delete case 5",
+    "delete case 6",
+    "left rotation",
+    "right rotation"
+  };
+
+// counts an event and saves it, overwriting the oldest saved event
+void traceRecord(TraceEvent event, int value)
+{
+  lock_guard<mutex> guard(traceLock);
+  counters[event]++;
+  TraceEntry& entry = ring[recorded % TRACE_BUFFER_SIZE];
+  entry.event = event;
+  entry.value = value;
+  recorded++;
+}
+
+// prints every nonzero counter, then the saved events from oldest to newest
+void tracePrint()
+{
+  lock_guard<mutex> guard(traceLock);
+  cout << "Event counts:" << endl;
+  for (int i = 0; i < TRACE_EVENT_COUNT; i++)
+    {
+      if (counters[i] > 0)
+	{
+	  cout << "  " << eventNames[i] << ": " << counters[i] << endl;
+	}
+    }
+
+  long first = 0;
+  if (recorded > TRACE_BUFFER_SIZE)
+    {
+      first = recorded - TRACE_BUFFER_SIZE;
+    }
+  cout << "Most recent " << (recorded - first) << " events:" << endl;
+  for (long i = first; i < recorded; i++)
+    {
+      TraceEntry& entry = ring[i % TRACE_BUFFER_SIZE];
+      cout << "  " << eventNames[entry.event] << " at " << entry.value << endl;
+    }
+}
+
+// zeroes the counters and forgets every saved event
+void traceReset()
+{
+  lock_guard<mutex> guard(traceLock);
+  for (int i = 0; i < TRACE_EVENT_COUNT; i++)
+    {
+      counters[i] = 0;
+    }
+  recorded = 0;
+}
+
+// returns how many times an event has happened since the last reset
+long traceCount(TraceEvent event)
+{
+  lock_guard<mutex> guard(traceLock);
+  return counters[event];
+}
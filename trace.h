@@ -0,0 +1,55 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include <iostream>
+
+/*
+ * Tracing for the tree operations. Build with -DRBTREE_TRACE to turn it on.
+ * Each TRACE(event, value) then bumps a counter for that event and saves
+ * the event in a ring buffer that holds the most recent TRACE_BUFFER_SIZE
+ * events. Nothing is printed until tracePrint() is called. Without
+ * RBTREE_TRACE, TRACE expands to nothing, so the hot paths pay nothing.
+ * With it, every event takes a lock so that worker threads can trace at
+ * the same time; a traced build is for looking at, not for timing.
+ */
+
+// every kind of event that can be traced
+enum TraceEvent
+  {
+    TRACE_INSERT_CASE1,
+    TRACE_INSERT_CASE2,
+    TRACE_INSERT_CASE3,
+    TRACE_INSERT_CASE4,
+    TRACE_INSERT_CASE5,
+    TRACE_INSERT_DUPLICATE,
+    TRACE_INSERT_UNEXPECTED, // fixInsert matched no case (a broken tree)
+    TRACE_REMOVE_NO_CHILDREN,
+    TRACE_REMOVE_ONE_CHILD,
+    TRACE_REMOVE_TWO_CHILDREN,
+    TRACE_REMOVE_PART1,
+    TRACE_REMOVE_PART2,
+    TRACE_REMOVE_PART3,
+    TRACE_DELETE_CASE1,
+    TRACE_DELETE_CASE2,
+    TRACE_DELETE_CASE3,
+    TRACE_DELETE_CASE4,
+    TRACE_DELETE_CASE5,
+    TRACE_DELETE_CASE6,
+    TRACE_LEFT_ROTATION,
+    TRACE_RIGHT_ROTATION,
+    TRACE_EVENT_COUNT // not an event; the number of events
+  };
+
+const int TRACE_BUFFER_SIZE = 1024;
+
+#ifdef RBTREE_TRACE
+#define TRACE(event, value) traceRecord(event, value)
+#else
+#define TRACE(event, value) ((void)0)
+#endif
+
+// functions
+void traceRecord(TraceEvent event, int value); // counts and saves an event
+void tracePrint(); // prints the counters and the most recent events
+void traceReset(); // zeroes the counters and empties the ring buffer
+long traceCount(TraceEvent event); // returns how many times event happened
+#endif
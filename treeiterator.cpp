@@ -0,0 +1,162 @@
+#include <iostream>
+#include "treeiterator.h"
+
+using namespace std;
+
+// default constructor; an iterator over an empty tree
+TreeIterator::TreeIterator()
+{
+  root = NULL;
+  current = NULL;
+}
+
+// regular constructor
+TreeIterator::TreeIterator(Node* newroot, Node* newcurrent)
+{
+  root = newroot;
+  current = newcurrent;
+}
+
+// destructor; the iterator doesn't own any nodes
+TreeIterator::~TreeIterator()
+{
+  root = NULL;
+  current = NULL;
+}
+
+// returns the current value
+int TreeIterator::operator*()
+{
+  return current->getValue();
+}
+
+// moves to the next largest node
+TreeIterator& TreeIterator::operator++()
+{
+  if (current != NULL)
+    {
+      current = current->getNext();
+    }
+  return *this;
+}
+
+// moves to the next smallest node; from the end, moves to the largest
+TreeIterator& TreeIterator::operator--()
+{
+  if (current != NULL)
+    {
+      current = current->getPrevious();
+    }
+  else if (root != NULL)
+    {
+      current = root;
+      while (current->getRight() != NULL)
+	{
+	  current = current->getRight();
+	}
+    }
+  return *this;
+}
+
+bool TreeIterator::operator==(const TreeIterator& other) const
+{
+  return current == other.current;
+}
+
+bool TreeIterator::operator!=(const TreeIterator& other) const
+{
+  return current != other.current;
+}
+
+// returns the current node, or NULL at the end
+Node* TreeIterator::getNode()
+{
+  return current;
+}
+
+// returns an iterator at the smallest node
+TreeIterator treeBegin(Node* root)
+{
+  Node* current = root;
+  while (current != NULL && current->getLeft() != NULL)
+    {
+      current = current->getLeft();
+    }
+  return TreeIterator(root, current);
+}
+
+// returns the iterator one past the largest node
+TreeIterator treeEnd(Node* root)
+{
+  return TreeIterator(root, NULL);
+}
+
+/**
+ * This function returns an iterator at the first node whose value is at
+ * least key. It walks down once from the root, remembering the last node
+ * where it went left.
+ */
+TreeIterator lowerBound(Node* root, int key)
+{
+  Node* current = root;
+  Node* best = NULL; // smallest value >= key seen so far
+  while (current != NULL)
+    {
+      if (current->getValue() >= key)
+	{
+	  best = current;
+	  current = current->getLeft();
+	}
+      else
+	{
+	  current = current->getRight();
+	}
+    }
+  return TreeIterator(root, best);
+}
+
+/**
+ * This function returns an iterator at the first node whose value is
+ * greater than key.
+ */
+TreeIterator upperBound(Node* root, int key)
+{
+  Node* current = root;
+  Node* best = NULL; // smallest value > key seen so far
+  while (current != NULL)
+    {
+      if (current->getValue() > key)
+	{
+	  best = current;
+	  current = current->getLeft();
+	}
+      else
+	{
+	  current = current->getRight();
+	}
+    }
+  return TreeIterator(root, best);
+}
+
+/**
+ * This function calls visit on every node with low <= value < high, in
+ * order. Finding the first node costs O(log n) and each step after that
+ * is O(1) on average, so the whole scan is O(log n + k) for k nodes.
+ *
+ * @param visit | called with each node and the data pointer
+ * @param data | passed through to visit untouched
+ * @return the number of nodes visited
+ */
+int rangeVisit(Node* root, int low, int high,
+	       void (*visit)(Node*, void*), void* data)
+{
+  int visited = 0;
+  Node* current = lowerBound(root, low).getNode();
+  while (current != NULL && current->getValue() < high)
+    {
+      visit(current, data);
+      visited++;
+      current = current->getNext();
+    }
+  return visited;
+}
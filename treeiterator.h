@@ -0,0 +1,43 @@
+#ifndef TREEITERATOR_H
+#define TREEITERATOR_H
+#include <iostream>
+#include "node.h"
+
+/*
+ * A TreeIterator walks the tree in order (smallest to largest) using the
+ * parent pointers, so it needs no recursion and no stack. It can also walk
+ * backwards. Stepping past the largest node gives the "end" iterator, and
+ * stepping back from the end gives the largest node again.
+ */
+class TreeIterator
+{
+ public:
+  // constructors and destructors
+  TreeIterator();
+  TreeIterator(Node*, Node*); // the root, and the node to start at
+  ~TreeIterator();
+
+  // functions
+  int operator*(); // returns the current value
+  TreeIterator& operator++(); // moves to the next largest node
+  TreeIterator& operator--(); // moves to the next smallest node
+  bool operator==(const TreeIterator&) const;
+  bool operator!=(const TreeIterator&) const;
+
+  // functions (getters)
+  Node* getNode(); // returns the current node, or NULL at the end
+
+ private:
+  // variables
+  Node* root; // needed to step back from the end
+  Node* current;
+};
+
+// functions
+TreeIterator treeBegin(Node* root); // the smallest node
+TreeIterator treeEnd(Node* root); // one past the largest node
+TreeIterator lowerBound(Node* root, int key); // first node >= key
+TreeIterator upperBound(Node* root, int key); // first node > key
+int rangeVisit(Node* root, int low, int high,
+	       void (*visit)(Node*, void*), void* data);
+#endif